@@ -0,0 +1,694 @@
+/* lsl_shim.c
+*
+* In-process stand-in for liblsl. Streams live in memory: an outlet fans its
+* samples out to the queues of the inlets connected to it, and a pull takes
+* them back out. There is no discovery and no network, so results do not
+* depend on the machine or on other traffic. Only the part of lsl_c.h that the
+* Pd objects use is implemented. Numeric samples are queued as doubles (int64
+* values beyond 2^53 lose precision). An inlet whose outlet went away reports
+* lsl_lost_error once drained, and picks up a new outlet with the same name.
+*
+*/
+
+#include "lsl_c.h"
+#include "lsl_shim.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+struct lsl_xml_ptr_struct_ {
+    char *name, *value;
+    struct lsl_xml_ptr_struct_ *parent, *first, *last, *next, *prev;
+};
+
+struct lsl_streaminfo_struct_ {
+    char *name, *type, *source_id;
+    int nchan;
+    double srate;
+    lsl_channel_format_t format;
+    struct lsl_xml_ptr_struct_ *desc;
+};
+
+typedef struct _queue {
+    unsigned long capacity, head, count;
+    double *timestamps;
+    double *values;             /* numeric formats */
+    char **strings;             /* cft_string */
+} t_queue;
+
+struct lsl_inlet_struct_ {
+    struct lsl_streaminfo_struct_ *info;
+    struct lsl_outlet_struct_ *source;
+    unsigned long maxbuffered;
+    t_queue q;
+    struct lsl_inlet_struct_ *next;
+};
+
+struct lsl_outlet_struct_ {
+    struct lsl_streaminfo_struct_ *info;
+    double lasttimestamp;
+    struct lsl_outlet_struct_ *next;
+};
+
+struct lsl_continuous_resolver_ {
+    char *prop, *value;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pushed = PTHREAD_COND_INITIALIZER;
+static struct lsl_outlet_struct_ *outlets;
+static struct lsl_inlet_struct_ *inlets;
+static int manualclock;
+static double clockvalue, timecorrection;
+static unsigned long dropped;
+
+/* ==== clock ==== */
+
+void lsl_shim_set_clock(double t){ manualclock = 1; clockvalue = t; }
+void lsl_shim_wall_clock(void){ manualclock = 0; }
+void lsl_shim_set_time_correction(double offset){ timecorrection = offset; }
+unsigned long lsl_shim_dropped(void){ return dropped; }
+
+double lsl_local_clock(){
+    struct timespec ts;
+    if (manualclock)
+        return clockvalue;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int lsl_protocol_version(){ return 110; }
+int lsl_library_version(){ return 110; }
+
+static char *dupstr(const char *s){
+    size_t n = strlen(s ? s : "") + 1;
+    char *d = malloc(n);
+    memcpy(d, s ? s : "", n);
+    return d;
+}
+
+void lsl_destroy_string(char *s){ free(s); }
+
+/* ==== xml ==== */
+
+static struct lsl_xml_ptr_struct_ *xml_new(const char *name){
+    struct lsl_xml_ptr_struct_ *e = calloc(1, sizeof(*e));
+    e->name = dupstr(name);
+    e->value = dupstr("");
+    return e;
+}
+
+static void xml_free(struct lsl_xml_ptr_struct_ *e){
+    while (e && e->first) {
+        struct lsl_xml_ptr_struct_ *c = e->first;
+        e->first = c->next;
+        xml_free(c);
+    }
+    if (e) {
+        free(e->name);
+        free(e->value);
+        free(e);
+    }
+}
+
+static struct lsl_xml_ptr_struct_ *xml_copy(struct lsl_xml_ptr_struct_ *e){
+    struct lsl_xml_ptr_struct_ *d = xml_new(e->name);
+    free(d->value);
+    d->value = dupstr(e->value);
+    for (struct lsl_xml_ptr_struct_ *c = e->first; c; c = c->next) {
+        struct lsl_xml_ptr_struct_ *cc = xml_copy(c);
+        cc->parent = d;
+        cc->prev = d->last;
+        if (d->last) d->last->next = cc; else d->first = cc;
+        d->last = cc;
+    }
+    return d;
+}
+
+lsl_xml_ptr lsl_first_child(lsl_xml_ptr e){ return e ? e->first : NULL; }
+lsl_xml_ptr lsl_last_child(lsl_xml_ptr e){ return e ? e->last : NULL; }
+lsl_xml_ptr lsl_next_sibling(lsl_xml_ptr e){ return e ? e->next : NULL; }
+lsl_xml_ptr lsl_previous_sibling(lsl_xml_ptr e){ return e ? e->prev : NULL; }
+lsl_xml_ptr lsl_parent(lsl_xml_ptr e){ return e ? e->parent : NULL; }
+lsl_xml_ptr lsl_child(lsl_xml_ptr e, char *name){
+    for (lsl_xml_ptr c = e ? e->first : NULL; c; c = c->next)
+        if (!strcmp(c->name, name)) return c;
+    return NULL;
+}
+lsl_xml_ptr lsl_next_sibling_n(lsl_xml_ptr e, char *name){
+    for (lsl_xml_ptr c = e ? e->next : NULL; c; c = c->next)
+        if (!strcmp(c->name, name)) return c;
+    return NULL;
+}
+lsl_xml_ptr lsl_previous_sibling_n(lsl_xml_ptr e, char *name){
+    for (lsl_xml_ptr c = e ? e->prev : NULL; c; c = c->prev)
+        if (!strcmp(c->name, name)) return c;
+    return NULL;
+}
+int lsl_empty(lsl_xml_ptr e){ return e == NULL; }
+int lsl_is_text(lsl_xml_ptr e){ return e && !e->first; }
+char *lsl_name(lsl_xml_ptr e){ return e ? e->name : ""; }
+char *lsl_value(lsl_xml_ptr e){ return e ? e->value : ""; }
+char *lsl_child_value(lsl_xml_ptr e){ return e && e->first ? e->first->value : ""; }
+char *lsl_child_value_n(lsl_xml_ptr e, char *name){
+    lsl_xml_ptr c = lsl_child(e, name);
+    return c ? c->value : "";
+}
+lsl_xml_ptr lsl_append_child(lsl_xml_ptr e, char *name){
+    lsl_xml_ptr c = xml_new(name);
+    c->parent = e;
+    c->prev = e->last;
+    if (e->last) e->last->next = c; else e->first = c;
+    e->last = c;
+    return c;
+}
+lsl_xml_ptr lsl_prepend_child(lsl_xml_ptr e, char *name){
+    lsl_xml_ptr c = xml_new(name);
+    c->parent = e;
+    c->next = e->first;
+    if (e->first) e->first->prev = c; else e->last = c;
+    e->first = c;
+    return c;
+}
+lsl_xml_ptr lsl_append_child_value(lsl_xml_ptr e, char *name, char *value){
+    lsl_xml_ptr c = lsl_append_child(e, name);
+    free(c->value);
+    c->value = dupstr(value);
+    return e;
+}
+lsl_xml_ptr lsl_prepend_child_value(lsl_xml_ptr e, char *name, char *value){
+    lsl_xml_ptr c = lsl_prepend_child(e, name);
+    free(c->value);
+    c->value = dupstr(value);
+    return e;
+}
+int lsl_set_child_value(lsl_xml_ptr e, char *name, char *value){
+    lsl_xml_ptr c = lsl_child(e, name);
+    if (!c) return 0;
+    free(c->value);
+    c->value = dupstr(value);
+    return 1;
+}
+int lsl_set_name(lsl_xml_ptr e, char *rhs){ free(e->name); e->name = dupstr(rhs); return 1; }
+int lsl_set_value(lsl_xml_ptr e, char *rhs){ free(e->value); e->value = dupstr(rhs); return 1; }
+
+/* ==== streaminfo ==== */
+
+lsl_streaminfo lsl_create_streaminfo(char *name, char *type, int channel_count, double nominal_srate, lsl_channel_format_t channel_format, char *source_id){
+    struct lsl_streaminfo_struct_ *info;
+    if (!name || !*name || channel_count < 0)
+        return NULL;
+    info = calloc(1, sizeof(*info));
+    info->name = dupstr(name);
+    info->type = dupstr(type);
+    info->source_id = dupstr(source_id);
+    info->nchan = channel_count;
+    info->srate = nominal_srate;
+    info->format = channel_format;
+    info->desc = xml_new("desc");
+    return info;
+}
+
+void lsl_destroy_streaminfo(lsl_streaminfo info){
+    if (!info) return;
+    free(info->name);
+    free(info->type);
+    free(info->source_id);
+    xml_free(info->desc);
+    free(info);
+}
+
+lsl_streaminfo lsl_copy_streaminfo(lsl_streaminfo info){
+    lsl_streaminfo c = lsl_create_streaminfo(info->name, info->type, info->nchan, info->srate, info->format, info->source_id);
+    xml_free(c->desc);
+    c->desc = xml_copy(info->desc);
+    return c;
+}
+
+char *lsl_get_name(lsl_streaminfo info){ return info->name; }
+char *lsl_get_type(lsl_streaminfo info){ return info->type; }
+int lsl_get_channel_count(lsl_streaminfo info){ return info->nchan; }
+double lsl_get_nominal_srate(lsl_streaminfo info){ return info->srate; }
+lsl_channel_format_t lsl_get_channel_format(lsl_streaminfo info){ return info->format; }
+char *lsl_get_source_id(lsl_streaminfo info){ return info->source_id; }
+int lsl_get_version(lsl_streaminfo info){ (void)info; return 110; }
+double lsl_get_created_at(lsl_streaminfo info){ (void)info; return 0; }
+char *lsl_get_uid(lsl_streaminfo info){ return info->name; }
+char *lsl_get_session_id(lsl_streaminfo info){ (void)info; return "default"; }
+char *lsl_get_hostname(lsl_streaminfo info){ (void)info; return "localhost"; }
+lsl_xml_ptr lsl_get_desc(lsl_streaminfo info){ return info->desc; }
+int lsl_get_channel_bytes(lsl_streaminfo info){
+    static const int bytes[] = {0, 4, 8, sizeof(char *), 4, 2, 1, 8};
+    return bytes[info->format];
+}
+int lsl_get_sample_bytes(lsl_streaminfo info){ return info->nchan * lsl_get_channel_bytes(info); }
+
+// the fixed fields only; the description isn't serialized
+char *lsl_get_xml(lsl_streaminfo info){
+    static const char *formats[] = {"undefined", "float32", "double64", "string", "int32", "int16", "int8", "int64"};
+    const char *fmt = "<?xml version=\"1.0\"?><info><name>%s</name><type>%s</type>"
+        "<channel_count>%d</channel_count><nominal_srate>%.17g</nominal_srate>"
+        "<channel_format>%s</channel_format><source_id>%s</source_id><desc /></info>";
+    size_t len = strlen(fmt) + strlen(info->name) + strlen(info->type) + strlen(info->source_id) + 64;
+    char *xml = malloc(len);
+    snprintf(xml, len, fmt, info->name, info->type, info->nchan, info->srate,
+        formats[info->format], info->source_id);
+    return xml;
+}
+
+/* ==== queues ==== */
+
+static void queue_init(t_queue *q, int nchan, lsl_channel_format_t format, unsigned long capacity){
+    q->capacity = capacity;
+    q->head = q->count = 0;
+    q->timestamps = malloc(capacity * sizeof(double));
+    if (format == cft_string)
+        q->strings = calloc(capacity * nchan, sizeof(char *));
+    else
+        q->values = malloc(capacity * nchan * sizeof(double));
+}
+
+static void queue_free(t_queue *q, int nchan){
+    if (q->strings) {
+        for (unsigned long i = 0; i < q->capacity * nchan; ++i)
+            free(q->strings[i]);
+        free(q->strings);
+    }
+    free(q->values);
+    free(q->timestamps);
+}
+
+// grow (or, at the inlet's limit, drop the oldest sample) so one more fits
+static unsigned long queue_slot(t_queue *q, int nchan, unsigned long limit){
+    unsigned long slot;
+    if (q->count == q->capacity && q->capacity < limit) {
+        unsigned long newcap = q->capacity * 2 < limit ? q->capacity * 2 : limit;
+        t_queue n;
+        n.capacity = newcap;
+        n.timestamps = malloc(newcap * sizeof(double));
+        n.values = q->values ? malloc(newcap * nchan * sizeof(double)) : NULL;
+        n.strings = q->strings ? calloc(newcap * nchan, sizeof(char *)) : NULL;
+        for (unsigned long i = 0; i < q->count; ++i) {
+            unsigned long from = (q->head + i) % q->capacity;
+            n.timestamps[i] = q->timestamps[from];
+            if (n.values)
+                memcpy(n.values + i * nchan, q->values + from * nchan, nchan * sizeof(double));
+            else
+                memcpy(n.strings + i * nchan, q->strings + from * nchan, nchan * sizeof(char *));
+        }
+        free(q->timestamps);
+        free(q->values);
+        free(q->strings);
+        q->timestamps = n.timestamps;
+        q->values = n.values;
+        q->strings = n.strings;
+        q->capacity = newcap;
+        q->head = 0;
+    }
+    if (q->count == q->capacity) {
+        if (q->strings)
+            for (int k = 0; k < nchan; ++k) {
+                free(q->strings[q->head * nchan + k]);
+                q->strings[q->head * nchan + k] = NULL;
+            }
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        dropped++;
+    }
+    slot = (q->head + q->count) % q->capacity;
+    q->count++;
+    return slot;
+}
+
+/* ==== outlet ==== */
+
+static int matches(lsl_streaminfo want, lsl_streaminfo have){
+    if (strcmp(want->name, have->name))
+        return 0;
+    if (*want->type && strcmp(want->type, have->type))
+        return 0;
+    return 1;
+}
+
+lsl_outlet lsl_create_outlet(lsl_streaminfo info, int chunk_size, int max_buffered){
+    struct lsl_outlet_struct_ *out;
+    (void)chunk_size; (void)max_buffered;
+    if (!info)
+        return NULL;
+    out = calloc(1, sizeof(*out));
+    out->info = lsl_copy_streaminfo(info);
+    pthread_mutex_lock(&lock);
+    out->next = outlets;
+    outlets = out;
+    for (lsl_inlet in = inlets; in; in = in->next)
+        if (!in->source && matches(in->info, out->info))
+            in->source = out;
+    pthread_mutex_unlock(&lock);
+    return out;
+}
+
+void lsl_destroy_outlet(lsl_outlet out){
+    struct lsl_outlet_struct_ **pp;
+    if (!out) return;
+    pthread_mutex_lock(&lock);
+    for (pp = &outlets; *pp; pp = &(*pp)->next)
+        if (*pp == out) { *pp = out->next; break; }
+    for (lsl_inlet in = inlets; in; in = in->next)
+        if (in->source == out)
+            in->source = NULL;
+    pthread_mutex_unlock(&lock);
+    lsl_destroy_streaminfo(out->info);
+    free(out);
+}
+
+lsl_streaminfo lsl_get_info(lsl_outlet out){ return lsl_copy_streaminfo(out->info); }
+
+int lsl_have_consumers(lsl_outlet out){
+    int have = 0;
+    pthread_mutex_lock(&lock);
+    for (lsl_inlet in = inlets; in; in = in->next)
+        if (in->source == out) have = 1;
+    pthread_mutex_unlock(&lock);
+    return have;
+}
+
+int lsl_wait_for_consumers(lsl_outlet out, double timeout){
+    (void)timeout;
+    return lsl_have_consumers(out);
+}
+
+// append n samples to every connected inlet; get(i, k) reads value k of sample i
+#define PUSH_NUMERIC(out, n, stamp, get) do { \
+    int nchan_ = (out)->info->nchan; \
+    pthread_mutex_lock(&lock); \
+    for (lsl_inlet in_ = inlets; in_; in_ = in_->next) { \
+        if (in_->source != (out)) continue; \
+        for (unsigned long i = 0; i < (n); ++i) { \
+            unsigned long slot_ = queue_slot(&in_->q, nchan_, in_->maxbuffered); \
+            in_->q.timestamps[slot_] = (stamp); \
+            for (int k = 0; k < nchan_; ++k) \
+                in_->q.values[slot_ * nchan_ + k] = (double)(get); \
+        } \
+    } \
+    pthread_cond_broadcast(&pushed); \
+    pthread_mutex_unlock(&lock); \
+} while (0)
+
+// time stamps of a chunk pushed with one stamp: the last sample carries it,
+// the earlier ones are spaced by the nominal rate
+static double chunk_stamp(lsl_outlet out, unsigned long i, unsigned long n, double last){
+    if (last == 0.0)
+        last = lsl_local_clock();
+    if (out->info->srate > 0)
+        return last - (double)(n - 1 - i) / out->info->srate;
+    return last;
+}
+
+#define DEFINE_PUSH(suffix, type) \
+int lsl_push_sample_##suffix##tp(lsl_outlet out, type *data, double timestamp, int pushthrough){ \
+    (void)pushthrough; \
+    if (timestamp == 0.0) timestamp = lsl_local_clock(); \
+    PUSH_NUMERIC(out, 1, timestamp, data[k]); \
+    return lsl_no_error; \
+} \
+int lsl_push_sample_##suffix##t(lsl_outlet out, type *data, double timestamp){ return lsl_push_sample_##suffix##tp(out, data, timestamp, 1); } \
+int lsl_push_sample_##suffix(lsl_outlet out, type *data){ return lsl_push_sample_##suffix##tp(out, data, 0.0, 1); } \
+int lsl_push_chunk_##suffix##tp(lsl_outlet out, type *data, unsigned long data_elements, double timestamp, int pushthrough){ \
+    unsigned long n = data_elements / out->info->nchan; \
+    (void)pushthrough; \
+    if (timestamp == 0.0) timestamp = lsl_local_clock(); \
+    PUSH_NUMERIC(out, n, chunk_stamp(out, i, n, timestamp), data[i * nchan_ + k]); \
+    return lsl_no_error; \
+} \
+int lsl_push_chunk_##suffix##t(lsl_outlet out, type *data, unsigned long data_elements, double timestamp){ return lsl_push_chunk_##suffix##tp(out, data, data_elements, timestamp, 1); } \
+int lsl_push_chunk_##suffix(lsl_outlet out, type *data, unsigned long data_elements){ return lsl_push_chunk_##suffix##tp(out, data, data_elements, 0.0, 1); } \
+int lsl_push_chunk_##suffix##tnp(lsl_outlet out, type *data, unsigned long data_elements, double *timestamps, int pushthrough){ \
+    unsigned long n = data_elements / out->info->nchan; \
+    (void)pushthrough; \
+    PUSH_NUMERIC(out, n, timestamps[i], data[i * nchan_ + k]); \
+    return lsl_no_error; \
+} \
+int lsl_push_chunk_##suffix##tn(lsl_outlet out, type *data, unsigned long data_elements, double *timestamps){ return lsl_push_chunk_##suffix##tnp(out, data, data_elements, timestamps, 1); }
+
+DEFINE_PUSH(f, float)
+DEFINE_PUSH(d, double)
+DEFINE_PUSH(l, long)
+DEFINE_PUSH(i, int)
+DEFINE_PUSH(s, short)
+DEFINE_PUSH(c, char)
+
+static void push_strings(lsl_outlet out, char **data, unsigned *lengths, unsigned long n, double *stamps, double last){
+    int nchan = out->info->nchan;
+    pthread_mutex_lock(&lock);
+    for (lsl_inlet in = inlets; in; in = in->next) {
+        if (in->source != out) continue;
+        for (unsigned long i = 0; i < n; ++i) {
+            unsigned long slot = queue_slot(&in->q, nchan, in->maxbuffered);
+            in->q.timestamps[slot] = stamps ? stamps[i] : chunk_stamp(out, i, n, last);
+            for (int k = 0; k < nchan; ++k) {
+                const char *src = data[i * nchan + k];
+                size_t len = lengths ? lengths[i * nchan + k] : strlen(src);
+                char *s = malloc(len + 1);
+                memcpy(s, src, len);
+                s[len] = 0;
+                in->q.strings[slot * nchan + k] = s;
+            }
+        }
+    }
+    pthread_cond_broadcast(&pushed);
+    pthread_mutex_unlock(&lock);
+}
+
+int lsl_push_sample_strtp(lsl_outlet out, char **data, double timestamp, int pushthrough){ (void)pushthrough; push_strings(out, data, NULL, 1, NULL, timestamp); return lsl_no_error; }
+int lsl_push_sample_strt(lsl_outlet out, char **data, double timestamp){ return lsl_push_sample_strtp(out, data, timestamp, 1); }
+int lsl_push_sample_str(lsl_outlet out, char **data){ return lsl_push_sample_strtp(out, data, 0.0, 1); }
+int lsl_push_sample_buftp(lsl_outlet out, char **data, unsigned *lengths, double timestamp, int pushthrough){ (void)pushthrough; push_strings(out, data, lengths, 1, NULL, timestamp); return lsl_no_error; }
+int lsl_push_sample_buft(lsl_outlet out, char **data, unsigned *lengths, double timestamp){ return lsl_push_sample_buftp(out, data, lengths, timestamp, 1); }
+int lsl_push_sample_buf(lsl_outlet out, char **data, unsigned *lengths){ return lsl_push_sample_buftp(out, data, lengths, 0.0, 1); }
+int lsl_push_chunk_strtp(lsl_outlet out, char **data, unsigned long data_elements, double timestamp, int pushthrough){ (void)pushthrough; push_strings(out, data, NULL, data_elements / out->info->nchan, NULL, timestamp); return lsl_no_error; }
+int lsl_push_chunk_strt(lsl_outlet out, char **data, unsigned long data_elements, double timestamp){ return lsl_push_chunk_strtp(out, data, data_elements, timestamp, 1); }
+int lsl_push_chunk_str(lsl_outlet out, char **data, unsigned long data_elements){ return lsl_push_chunk_strtp(out, data, data_elements, 0.0, 1); }
+int lsl_push_chunk_strtnp(lsl_outlet out, char **data, unsigned long data_elements, double *timestamps, int pushthrough){ (void)pushthrough; push_strings(out, data, NULL, data_elements / out->info->nchan, timestamps, 0.0); return lsl_no_error; }
+int lsl_push_chunk_strtn(lsl_outlet out, char **data, unsigned long data_elements, double *timestamps){ return lsl_push_chunk_strtnp(out, data, data_elements, timestamps, 1); }
+int lsl_push_chunk_buftp(lsl_outlet out, char **data, unsigned *lengths, unsigned long data_elements, double timestamp, int pushthrough){ (void)pushthrough; push_strings(out, data, lengths, data_elements / out->info->nchan, NULL, timestamp); return lsl_no_error; }
+int lsl_push_chunk_buft(lsl_outlet out, char **data, unsigned *lengths, unsigned long data_elements, double timestamp){ return lsl_push_chunk_buftp(out, data, lengths, data_elements, timestamp, 1); }
+int lsl_push_chunk_buf(lsl_outlet out, char **data, unsigned *lengths, unsigned long data_elements){ return lsl_push_chunk_buftp(out, data, lengths, data_elements, 0.0, 1); }
+int lsl_push_chunk_buftnp(lsl_outlet out, char **data, unsigned *lengths, unsigned long data_elements, double *timestamps, int pushthrough){ (void)pushthrough; push_strings(out, data, lengths, data_elements / out->info->nchan, timestamps, 0.0); return lsl_no_error; }
+int lsl_push_chunk_buftn(lsl_outlet out, char **data, unsigned *lengths, unsigned long data_elements, double *timestamps){ return lsl_push_chunk_buftnp(out, data, lengths, data_elements, timestamps, 1); }
+
+/* ==== inlet ==== */
+
+lsl_inlet lsl_create_inlet(lsl_streaminfo info, int max_buflen, int max_chunklen, int recover){
+    struct lsl_inlet_struct_ *in;
+    (void)max_chunklen; (void)recover;
+    if (!info)
+        return NULL;
+    in = calloc(1, sizeof(*in));
+    in->info = lsl_copy_streaminfo(info);
+    // seconds at the nominal rate, otherwise x100 samples (as in liblsl)
+    if (max_buflen <= 0)
+        max_buflen = 360;
+    in->maxbuffered = info->srate > 0 ? (unsigned long)(max_buflen * info->srate) : (unsigned long)max_buflen * 100;
+    if (in->maxbuffered < 1)
+        in->maxbuffered = 1;
+    queue_init(&in->q, info->nchan, info->format, in->maxbuffered < 64 ? in->maxbuffered : 64);
+    pthread_mutex_lock(&lock);
+    for (lsl_outlet out = outlets; out; out = out->next)
+        if (matches(in->info, out->info)) { in->source = out; break; }
+    in->next = inlets;
+    inlets = in;
+    pthread_mutex_unlock(&lock);
+    return in;
+}
+
+void lsl_destroy_inlet(lsl_inlet in){
+    struct lsl_inlet_struct_ **pp;
+    if (!in) return;
+    pthread_mutex_lock(&lock);
+    for (pp = &inlets; *pp; pp = &(*pp)->next)
+        if (*pp == in) { *pp = in->next; break; }
+    pthread_mutex_unlock(&lock);
+    queue_free(&in->q, in->info->nchan);
+    lsl_destroy_streaminfo(in->info);
+    free(in);
+}
+
+lsl_streaminfo lsl_get_fullinfo(lsl_inlet in, double timeout, int *ec){
+    lsl_streaminfo info = NULL;
+    (void)timeout;
+    pthread_mutex_lock(&lock);
+    if (in->source)
+        info = lsl_copy_streaminfo(in->source->info);
+    pthread_mutex_unlock(&lock);
+    if (ec)
+        *ec = info ? lsl_no_error : lsl_timeout_error;
+    return info ? info : lsl_copy_streaminfo(in->info);
+}
+
+void lsl_open_stream(lsl_inlet in, double timeout, int *ec){ (void)in; (void)timeout; if (ec) *ec = lsl_no_error; }
+void lsl_close_stream(lsl_inlet in){ (void)in; }
+double lsl_time_correction(lsl_inlet in, double timeout, int *ec){ (void)in; (void)timeout; if (ec) *ec = lsl_no_error; return timecorrection; }
+int lsl_set_postprocessing(lsl_inlet in, unsigned flags){ (void)in; return flags > proc_ALL ? lsl_argument_error : lsl_no_error; }
+int lsl_smoothing_halftime(lsl_inlet in, float value){ (void)in; return value > 0 ? lsl_no_error : lsl_argument_error; }
+unsigned lsl_was_clock_reset(lsl_inlet in){ (void)in; return 0; }
+
+unsigned lsl_samples_available(lsl_inlet in){
+    unsigned n;
+    pthread_mutex_lock(&lock);
+    n = (unsigned)in->q.count;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+// wait (with the lock held) until the inlet has a sample or the timeout expires
+static int wait_for_data(lsl_inlet in, double timeout){
+    struct timespec deadline;
+    if (in->q.count || timeout <= 0.0)
+        return in->q.count > 0;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)timeout;
+    deadline.tv_nsec += (long)((timeout - (time_t)timeout) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!in->q.count)
+        if (pthread_cond_timedwait(&pushed, &lock, &deadline) == ETIMEDOUT)
+            break;
+    return in->q.count > 0;
+}
+
+// (with the lock held) a drained inlet without an outlet has lost its stream
+static int pull_status(lsl_inlet in){
+    return !in->source && !in->q.count ? lsl_lost_error : lsl_no_error;
+}
+
+// chunk pulls return what is queued once the first sample is there
+#define DEFINE_PULL(suffix, type) \
+unsigned long lsl_pull_chunk_##suffix(lsl_inlet in, type *data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, int *ec){ \
+    int nchan = in->info->nchan; \
+    unsigned long n = 0, max = data_buffer_elements / nchan; \
+    (void)timestamp_buffer_elements; \
+    pthread_mutex_lock(&lock); \
+    if (ec) *ec = pull_status(in); \
+    if (wait_for_data(in, timeout)) { \
+        for (; n < max && in->q.count; ++n) { \
+            unsigned long slot = in->q.head; \
+            if (timestamp_buffer) timestamp_buffer[n] = in->q.timestamps[slot]; \
+            for (int k = 0; k < nchan; ++k) \
+                data_buffer[n * nchan + k] = (type)in->q.values[slot * nchan + k]; \
+            in->q.head = (in->q.head + 1) % in->q.capacity; \
+            in->q.count--; \
+        } \
+    } \
+    pthread_mutex_unlock(&lock); \
+    return n * nchan; \
+} \
+double lsl_pull_sample_##suffix(lsl_inlet in, type *buffer, int buffer_elements, double timeout, int *ec){ \
+    double ts = 0.0; \
+    if (buffer_elements < in->info->nchan) { if (ec) *ec = lsl_argument_error; return 0.0; } \
+    return lsl_pull_chunk_##suffix(in, buffer, &ts, in->info->nchan, 1, timeout, ec) ? ts : 0.0; \
+}
+
+DEFINE_PULL(f, float)
+DEFINE_PULL(d, double)
+DEFINE_PULL(l, long)
+DEFINE_PULL(i, int)
+DEFINE_PULL(s, short)
+DEFINE_PULL(c, char)
+
+unsigned long lsl_pull_chunk_str(lsl_inlet in, char **data_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, int *ec){
+    int nchan = in->info->nchan;
+    unsigned long n = 0, max = data_buffer_elements / nchan;
+    (void)timestamp_buffer_elements;
+    pthread_mutex_lock(&lock);
+    if (ec) *ec = pull_status(in);
+    if (wait_for_data(in, timeout)) {
+        for (; n < max && in->q.count; ++n) {
+            unsigned long slot = in->q.head;
+            if (timestamp_buffer) timestamp_buffer[n] = in->q.timestamps[slot];
+            for (int k = 0; k < nchan; ++k) {
+                // ownership passes to the caller (lsl_destroy_string)
+                data_buffer[n * nchan + k] = in->q.strings[slot * nchan + k];
+                in->q.strings[slot * nchan + k] = NULL;
+            }
+            in->q.head = (in->q.head + 1) % in->q.capacity;
+            in->q.count--;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return n * nchan;
+}
+
+double lsl_pull_sample_str(lsl_inlet in, char **buffer, int buffer_elements, double timeout, int *ec){
+    double ts = 0.0;
+    if (buffer_elements < in->info->nchan) { if (ec) *ec = lsl_argument_error; return 0.0; }
+    return lsl_pull_chunk_str(in, buffer, &ts, in->info->nchan, 1, timeout, ec) ? ts : 0.0;
+}
+
+unsigned long lsl_pull_chunk_buf(lsl_inlet in, char **data_buffer, unsigned *lengths_buffer, double *timestamp_buffer, unsigned long data_buffer_elements, unsigned long timestamp_buffer_elements, double timeout, int *ec){
+    unsigned long n = lsl_pull_chunk_str(in, data_buffer, timestamp_buffer, data_buffer_elements, timestamp_buffer_elements, timeout, ec);
+    for (unsigned long i = 0; i < n; ++i)
+        lengths_buffer[i] = (unsigned)strlen(data_buffer[i]);
+    return n;
+}
+
+double lsl_pull_sample_buf(lsl_inlet in, char **buffer, unsigned *buffer_lengths, int buffer_elements, double timeout, int *ec){
+    double ts = 0.0;
+    if (buffer_elements < in->info->nchan) { if (ec) *ec = lsl_argument_error; return 0.0; }
+    return lsl_pull_chunk_buf(in, buffer, buffer_lengths, &ts, in->info->nchan, 1, timeout, ec) ? ts : 0.0;
+}
+
+/* ==== resolving ==== */
+
+static int resolve(const char *prop, const char *value, lsl_streaminfo *buffer, unsigned buffer_elements){
+    int n = 0;
+    pthread_mutex_lock(&lock);
+    for (lsl_outlet out = outlets; out && (unsigned)n < buffer_elements; out = out->next) {
+        const char *have = NULL;
+        if (!prop) have = value = "";
+        else if (!strcmp(prop, "name")) have = out->info->name;
+        else if (!strcmp(prop, "type")) have = out->info->type;
+        else if (!strcmp(prop, "source_id")) have = out->info->source_id;
+        if (have && !strcmp(have, value))
+            buffer[n++] = lsl_copy_streaminfo(out->info);
+    }
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+int lsl_resolve_all(lsl_streaminfo *buffer, unsigned buffer_elements, double wait_time){
+    (void)wait_time;
+    return resolve(NULL, NULL, buffer, buffer_elements);
+}
+
+int lsl_resolve_byprop(lsl_streaminfo *buffer, unsigned buffer_elements, char *prop, char *value, int minimum, double timeout){
+    (void)minimum; (void)timeout;
+    return resolve(prop, value, buffer, buffer_elements);
+}
+
+lsl_continuous_resolver lsl_create_continuous_resolver(double forget_after){
+    (void)forget_after;
+    return calloc(1, sizeof(struct lsl_continuous_resolver_));
+}
+
+lsl_continuous_resolver lsl_create_continuous_resolver_byprop(char *prop, char *value, double forget_after){
+    lsl_continuous_resolver res = lsl_create_continuous_resolver(forget_after);
+    res->prop = dupstr(prop);
+    res->value = dupstr(value);
+    return res;
+}
+
+int lsl_resolver_results(lsl_continuous_resolver res, lsl_streaminfo *buffer, unsigned buffer_elements){
+    return resolve(res->prop, res->value, buffer, buffer_elements);
+}
+
+void lsl_destroy_continuous_resolver(lsl_continuous_resolver res){
+    if (!res) return;
+    free(res->prop);
+    free(res->value);
+    free(res);
+}
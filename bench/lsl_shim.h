@@ -0,0 +1,19 @@
+/* lsl_shim.h
+*
+* Controls for the in-process liblsl stand-in (lsl_shim.c).
+*
+*/
+
+#ifndef LSL_SHIM_H
+#define LSL_SHIM_H
+
+/* freeze lsl_local_clock() at t seconds (it only moves when set again) */
+void lsl_shim_set_clock(double t);
+/* return to the monotonic wall clock */
+void lsl_shim_wall_clock(void);
+/* value reported by lsl_time_correction() for every inlet */
+void lsl_shim_set_time_correction(double offset);
+/* samples dropped so far because an inlet buffer was full */
+unsigned long lsl_shim_dropped(void);
+
+#endif
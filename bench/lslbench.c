@@ -0,0 +1,200 @@
+/* lslbench.c
+*
+* Headless benchmark of the send and receive paths. [lslsend] feeds an LSL
+* outlet and [lslreceive] pulls it back over loopback, both driven through the
+* stub Pd runtime (pdstub.c). For every combination of format, channel count
+* and rate one JSON object is printed per line:
+*
+*   send_sps, recv_sps        samples per second the Pd thread spends pushing /
+*                             pulling and emitting (backlog drained flat out)
+*   send_allocs, recv_allocs  Pd allocations per sample (getbytes, new symbols)
+*   p50_ms, p99_ms            time from the sample's list entering [lslsend] to
+*                             its list leaving [lslreceive] (both on
+*                             lsl_local_clock()), with the scheduler and the
+*                             sender paced in real time
+*   lost                      samples sent in the paced run that never arrived
+*
+* usage: lslbench [seconds per paced run]
+*
+* Built with 'make bench LSL_SHIM=yes' it runs against the in-memory liblsl
+* stand-in (lsl_shim.c), which takes the network out of the numbers.
+*
+*/
+
+#include "m_pd.h"
+#include "lsl_c.h"
+#include "lslpd.h"
+#include "pdstub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_SECONDS 2.0     //length of each paced run
+#define TICK_MS (64 * 1000.0 / 44100)   //one Pd scheduler tick at the default block size
+#define CONNECT_TIMEOUT 10.0    //seconds to wait for the receiver to find the stream
+#define DRAIN_TIMEOUT 10.0      //seconds to wait for a backlog to arrive
+#define BACKLOG_VALUES 1000000  //values pushed in the throughput run (at most 20000 samples)
+#define MAX_BACKLOG 20000       //stays below the receiver's inlet buffer for irregular streams
+#define MAX_VALUES_PER_SECOND 2e6   //larger combinations are skipped
+#define DISTINCT_VALUES 100     //values cycle, so string streams don't create a symbol per sample
+
+static const char *formats[] = { "float32", "double64", "int16", "string" };
+static const int channels[] = { 1, 8, 64, 256 };
+static const double rates[] = { 100, 1000, 10000 };
+
+void lslsend_setup(void);
+void lslreceive_setup(void);
+
+typedef struct _bench {
+    long received;
+    int connected;
+    int timing;                 /* record latencies */
+    double *sent_at;            /* lsl_local_clock() when each paced sample went into [lslsend] */
+    double *latency;            /* in seconds */
+    long nlatency;
+    long maxlatency;
+} t_bench;
+
+static void bench_outlet(void *owner, int outno, t_symbol *s, int argc, t_atom *argv){
+    t_bench *b = (t_bench *)owner;
+
+    // samples arrive in the order they were sent, so the n-th list is the n-th sample
+    if (outno == 1) {
+        if (b->timing && b->nlatency < b->maxlatency)
+            b->latency[b->nlatency++] = lsl_local_clock() - b->sent_at[b->received];
+        b->received++;
+    } else if (outno == 2 && argc && argv->a_type == A_SYMBOL) {
+        b->connected = !strcmp(argv->a_w.w_symbol->s_name, "connected");
+    }
+}
+
+static void bench_fill(t_atom *sample, int nchan, long i){
+    for (int k = 0; k < nchan; ++k)
+        SETFLOAT(sample + k, (i + k) % DISTINCT_VALUES);
+}
+
+static int bench_compare(const void *a, const void *b){
+    double d = *(const double *)a - *(const double *)b;
+    return d < 0 ? -1 : d > 0;
+}
+
+// keep the scheduler running (in real time) until the condition holds or time runs out
+#define BENCH_WAIT(cond, timeout) do { \
+        double until = lsl_local_clock() + (timeout); \
+        while (!(cond) && lsl_local_clock() < until) { \
+            stub_advance(TICK_MS); \
+            lslpd_sleep(TICK_MS * 0.001); \
+        } \
+    } while (0)
+
+static void bench_case(const char *format, int nchan, double rate, double seconds, int id){
+    t_bench b = {0};
+    t_atom args[6], *sample = (t_atom *)calloc(nchan, sizeof(t_atom));
+    t_object *send, *receive;
+    char name[32];
+    long n, allocs, sent = 0;
+    double start, spent = 0, send_sps, send_allocs, recv_sps, recv_allocs;
+
+    snprintf(name, sizeof(name), "lslbench%d", id);
+    SETSYMBOL(args, gensym(name));
+    SETSYMBOL(args + 1, gensym("bench"));
+    SETFLOAT(args + 2, nchan);
+    SETSYMBOL(args + 3, gensym(format));
+    SETSYMBOL(args + 4, gensym("-maxpertick"));
+    SETFLOAT(args + 5, MAX_BACKLOG);
+    send = stub_new("lslsend", 4, args);
+    receive = stub_new("lslreceive", 6, args);
+    if (!send || !receive) {
+        fprintf(stderr, "lslbench: could not create the objects for %s\n", name);
+        exit(1);
+    }
+    for (int i = 0; i < 3; ++i)
+        stub_watch(receive, i, bench_outlet, &b);
+    BENCH_WAIT(b.connected, CONNECT_TIMEOUT);
+    if (!b.connected) {
+        fprintf(stderr, "lslbench: %s was not found\n", name);
+        exit(1);
+    }
+
+    // throughput: push a backlog flat out, then let the receiver drain it
+    n = BACKLOG_VALUES / nchan;
+    if (n > MAX_BACKLOG)
+        n = MAX_BACKLOG;
+    allocs = stub_allocations();
+    start = lsl_local_clock();
+    for (long i = 0; i < n; ++i) {
+        bench_fill(sample, nchan, i);
+        stub_list(send, nchan, sample);
+    }
+    send_sps = n / (lsl_local_clock() - start);
+    send_allocs = (double)(stub_allocations() - allocs) / n;
+
+    allocs = stub_allocations();
+    start = lsl_local_clock();
+    while (b.received < n && lsl_local_clock() < start + DRAIN_TIMEOUT) {
+        double t = lsl_local_clock();
+        stub_advance(TICK_MS);
+        spent += lsl_local_clock() - t;
+        if (b.received < n)
+            lslpd_sleep(0.0005);
+    }
+    recv_sps = b.received / spent;
+    recv_allocs = (double)(stub_allocations() - allocs) / (b.received ? b.received : 1);
+
+    // latency: push at the rate while the scheduler ticks in real time
+    b.received = 0;
+    b.maxlatency = (long)(rate * seconds) + 1;
+    b.latency = (double *)calloc(b.maxlatency, sizeof(double));
+    b.sent_at = (double *)calloc(b.maxlatency, sizeof(double));
+    b.timing = 1;
+    start = lsl_local_clock();
+    for (double next = start; next < start + seconds; next += TICK_MS * 0.001) {
+        long due = (long)((next - start) * rate);
+        for (; sent < due && sent < b.maxlatency; ++sent) {
+            bench_fill(sample, nchan, sent);
+            b.sent_at[sent] = lsl_local_clock();
+            stub_list(send, nchan, sample);
+        }
+        stub_advance(TICK_MS);
+        if (next + TICK_MS * 0.001 > lsl_local_clock())
+            lslpd_sleep(next + TICK_MS * 0.001 - lsl_local_clock());
+    }
+    BENCH_WAIT(b.received >= sent, 1.0);
+    qsort(b.latency, b.nlatency, sizeof(double), bench_compare);
+    if (b.nlatency && b.latency[0] < 0) {
+        fprintf(stderr, "lslbench: negative latency (%.3f ms) for %s, the measurement is broken\n",
+            b.latency[0] * 1000, name);
+        exit(1);
+    }
+
+    printf("{\"format\":\"%s\",\"channels\":%d,\"rate\":%g,\"samples\":%ld,"
+        "\"send_sps\":%.0f,\"send_allocs\":%.3f,\"recv_sps\":%.0f,\"recv_allocs\":%.3f,"
+        "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"lost\":%ld,\"simd\":\"%s\"}\n",
+        format, nchan, rate, n, send_sps, send_allocs, recv_sps, recv_allocs,
+        b.nlatency ? b.latency[b.nlatency / 2] * 1000 : -1,
+        b.nlatency ? b.latency[(long)(b.nlatency * 0.99)] * 1000 : -1,
+        sent - b.received, lslpd_simd_name());
+    fflush(stdout);
+
+    stub_free(receive);
+    stub_free(send);
+    free(b.latency);
+    free(b.sent_at);
+    free(sample);
+}
+
+int main(int argc, char **argv){
+    double seconds = argc > 1 ? atof(argv[1]) : DEFAULT_SECONDS;
+    int id = 0;
+
+    if (seconds <= 0)
+        seconds = DEFAULT_SECONDS;
+    lslsend_setup();
+    lslreceive_setup();
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+        for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); ++c)
+            for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+                if (channels[c] * rates[r] <= MAX_VALUES_PER_SECOND)
+                    bench_case(formats[f], channels[c], rates[r], seconds, id++);
+    return 0;
+}
@@ -0,0 +1,421 @@
+/* pdstub.c
+*
+* Minimal stand-in for the Pd runtime (see pdstub.h). Only what the control
+* objects use is implemented; messages are dispatched by selector and every
+* outlet call is counted and can be watched.
+*
+*/
+
+#include "m_pd.h"
+#include "pdstub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define SYMBOL_HASH 4096
+#define MAX_METHODS 32
+#define MAX_METHOD_ARGS 5
+
+t_symbol s_pointer = {"pointer", 0, 0}, s_float = {"float", 0, 0}, s_symbol = {"symbol", 0, 0},
+    s_bang = {"bang", 0, 0}, s_list = {"list", 0, 0}, s_anything = {"anything", 0, 0},
+    s_signal = {"signal", 0, 0}, s__N = {"#N", 0, 0}, s__X = {"#X", 0, 0},
+    s_x = {"x", 0, 0}, s_y = {"y", 0, 0}, s_ = {"", 0, 0};
+
+int stub_verbose;
+static long stub_nalloc;
+static t_symbol *symhash[SYMBOL_HASH];
+
+
+/* ==== memory and symbols ==== */
+
+void *getbytes(size_t nbytes){
+    stub_nalloc++;
+    return calloc(1, nbytes ? nbytes : 1);
+}
+
+void *resizebytes(void *old, size_t oldsize, size_t newsize){
+    char *p;
+    stub_nalloc++;
+    p = (char *)realloc(old, newsize ? newsize : 1);
+    if (newsize > oldsize)
+        memset(p + oldsize, 0, newsize - oldsize);
+    return p;
+}
+
+void *copybytes(const void *src, size_t nbytes){
+    void *p = getbytes(nbytes);
+    memcpy(p, src, nbytes);
+    return p;
+}
+
+void freebytes(void *x, size_t nbytes){
+    free(x);
+}
+
+t_symbol *gensym(const char *s){
+    unsigned int hash = 5381;
+    t_symbol *sym;
+
+    for (const char *p = s; *p; p++)
+        hash = hash * 33 + (unsigned char)*p;
+    hash &= SYMBOL_HASH - 1;
+    for (sym = symhash[hash]; sym; sym = sym->s_next)
+        if (!strcmp(sym->s_name, s))
+            return sym;
+    // Pd never frees symbols either, so a new one counts as an allocation
+    stub_nalloc++;
+    sym = (t_symbol *)calloc(1, sizeof(t_symbol));
+    sym->s_name = strdup(s);
+    sym->s_next = symhash[hash];
+    symhash[hash] = sym;
+    return sym;
+}
+
+long stub_allocations(void){
+    return stub_nalloc;
+}
+
+
+/* ==== atoms ==== */
+
+t_float atom_getfloat(const t_atom *a){
+    return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+t_int atom_getint(const t_atom *a){
+    return (t_int)atom_getfloat(a);
+}
+
+t_symbol *atom_getsymbol(const t_atom *a){
+    return a->a_type == A_SYMBOL ? a->a_w.w_symbol : &s_float;
+}
+
+t_float atom_getfloatarg(int which, int argc, const t_atom *argv){
+    return which < argc ? atom_getfloat(argv + which) : 0;
+}
+
+t_int atom_getintarg(int which, int argc, const t_atom *argv){
+    return which < argc ? atom_getint(argv + which) : 0;
+}
+
+t_symbol *atom_getsymbolarg(int which, int argc, const t_atom *argv){
+    return which < argc ? atom_getsymbol(argv + which) : &s_;
+}
+
+void atom_string(const t_atom *a, char *buf, unsigned int bufsize){
+    if (a->a_type == A_SYMBOL)
+        snprintf(buf, bufsize, "%s", a->a_w.w_symbol->s_name);
+    else
+        snprintf(buf, bufsize, "%g", a->a_w.w_float);
+}
+
+
+/* ==== classes and messages ==== */
+
+typedef struct _stub_method {
+    t_symbol *sel;
+    t_method fn;
+    t_atomtype args[MAX_METHOD_ARGS + 1];
+} t_stub_method;
+
+struct _class {
+    t_symbol *c_name;
+    t_newmethod c_new;
+    t_method c_free;
+    size_t c_size;
+    t_stub_method c_methods[MAX_METHODS];
+    int c_nmethods;
+    t_method c_bang, c_float, c_list, c_anything;
+    struct _class *c_next;
+};
+
+static t_class *classlist;
+t_class *garray_class;
+
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod,
+    size_t size, int flags, t_atomtype arg1, ...){
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    c->c_name = name;
+    c->c_new = newmethod;
+    c->c_free = freemethod;
+    c->c_size = size;
+    c->c_next = classlist;
+    classlist = c;
+    return c;
+}
+
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...){
+    t_stub_method *m = &c->c_methods[c->c_nmethods++];
+    t_atomtype type = arg1;
+    va_list ap;
+    int i = 0;
+
+    m->sel = sel;
+    m->fn = fn;
+    va_start(ap, arg1);
+    while (type != A_NULL && i < MAX_METHOD_ARGS) {
+        m->args[i++] = type;
+        type = (t_atomtype)va_arg(ap, int);
+    }
+    va_end(ap);
+    m->args[i] = A_NULL;
+}
+
+void class_addbang(t_class *c, t_method fn){ c->c_bang = fn; }
+void class_addlist(t_class *c, t_method fn){ c->c_list = fn; }
+void class_addanything(t_class *c, t_method fn){ c->c_anything = fn; }
+void class_doaddfloat(t_class *c, t_method fn){ c->c_float = fn; }
+void class_addsymbol(t_class *c, t_method fn){}
+void class_addpointer(t_class *c, t_method fn){}
+void class_sethelpsymbol(t_class *c, t_symbol *s){}
+
+t_pd *pd_new(t_class *c){
+    t_pd *x = (t_pd *)getbytes(c->c_size);
+    *x = c;
+    return x;
+}
+
+t_object *stub_new(const char *name, int argc, t_atom *argv){
+    t_class *c;
+    for (c = classlist; c; c = c->c_next)
+        if (!strcmp(c->c_name->s_name, name))
+            break;
+    if (!c || !c->c_new)
+        return NULL;
+    // A_GIMME constructors; the objects declare argc as long
+    return ((t_object *(*)(t_symbol *, long, t_atom *))c->c_new)(c->c_name, argc, argv);
+}
+
+void stub_free(t_object *x){
+    t_class *c = *(t_pd *)x;
+    if (c->c_free)
+        ((void (*)(void *))c->c_free)(x);
+    free(x);
+}
+
+void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv){
+    t_class *c = *x;
+
+    if (s == &s_bang && c->c_bang) {
+        ((void (*)(void *))c->c_bang)(x);
+        return;
+    }
+    if (s == &s_list && c->c_list) {
+        ((void (*)(void *, t_symbol *, int, t_atom *))c->c_list)(x, s, argc, argv);
+        return;
+    }
+    if (s == &s_float && c->c_float) {
+        ((void (*)(void *, t_float))c->c_float)(x, atom_getfloatarg(0, argc, argv));
+        return;
+    }
+    for (int i = 0; i < c->c_nmethods; ++i) {
+        t_stub_method *m = &c->c_methods[i];
+        if (m->sel != s)
+            continue;
+        // only the argument shapes the objects use
+        if (m->args[0] == A_GIMME)
+            ((void (*)(void *, t_symbol *, int, t_atom *))m->fn)(x, s, argc, argv);
+        else if (m->args[0] == A_NULL)
+            ((void (*)(void *))m->fn)(x);
+        else if (m->args[0] == A_FLOAT || m->args[0] == A_DEFFLOAT)
+            ((void (*)(void *, t_float))m->fn)(x, atom_getfloatarg(0, argc, argv));
+        else
+            ((void (*)(void *, t_symbol *))m->fn)(x, atom_getsymbolarg(0, argc, argv));
+        return;
+    }
+    if (c->c_anything)
+        ((void (*)(void *, t_symbol *, int, t_atom *))c->c_anything)(x, s, argc, argv);
+    else
+        fprintf(stderr, "%s: no method for '%s'\n", c->c_name->s_name, s->s_name);
+}
+
+void pd_bang(t_pd *x){ pd_typedmess(x, &s_bang, 0, NULL); }
+void pd_list(t_pd *x, t_symbol *s, int argc, t_atom *argv){ pd_typedmess(x, &s_list, argc, argv); }
+
+void stub_list(t_object *x, int argc, t_atom *argv){
+    pd_typedmess(&x->ob_pd, argc ? &s_list : &s_bang, argc, argv);
+}
+
+void stub_message(t_object *x, const char *sel, int argc, t_atom *argv){
+    pd_typedmess(&x->ob_pd, gensym(sel), argc, argv);
+}
+
+// no canvases here, so no named arrays either
+t_pd *pd_findbyclass(t_symbol *s, const t_class *c){ return NULL; }
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec){ return 0; }
+void garray_redraw(t_garray *x){}
+
+
+/* ==== inlets and outlets ==== */
+
+struct _inlet {
+    int dummy;
+};
+
+struct _outlet {
+    t_object *o_owner;
+    struct _outlet *o_next;
+    int o_no;
+    long o_calls;
+    t_stub_outhook o_hook;
+    void *o_hookowner;
+};
+
+t_inlet *inlet_new(t_object *owner, t_pd *dest, t_symbol *s1, t_symbol *s2){
+    return (t_inlet *)calloc(1, sizeof(t_inlet));
+}
+
+t_inlet *floatinlet_new(t_object *owner, t_float *fp){
+    return (t_inlet *)calloc(1, sizeof(t_inlet));
+}
+
+t_outlet *outlet_new(t_object *owner, t_symbol *s){
+    t_outlet *o = (t_outlet *)calloc(1, sizeof(t_outlet)), **link;
+    o->o_owner = owner;
+    for (link = &owner->te_outlet; *link; link = &(*link)->o_next)
+        o->o_no++;
+    *link = o;
+    return o;
+}
+
+static t_outlet *stub_outlet(t_object *x, int outno){
+    t_outlet *o = x->te_outlet;
+    while (o && outno--)
+        o = o->o_next;
+    return o;
+}
+
+void stub_watch(t_object *x, int outno, t_stub_outhook hook, void *owner){
+    t_outlet *o = stub_outlet(x, outno);
+    if (o) {
+        o->o_hook = hook;
+        o->o_hookowner = owner;
+    }
+}
+
+long stub_outcalls(t_object *x, int outno){
+    t_outlet *o = stub_outlet(x, outno);
+    return o ? o->o_calls : 0;
+}
+
+static void outlet_send(t_outlet *o, t_symbol *s, int argc, t_atom *argv){
+    o->o_calls++;
+    if (o->o_hook)
+        o->o_hook(o->o_hookowner, o->o_no, s, argc, argv);
+}
+
+void outlet_bang(t_outlet *x){ outlet_send(x, &s_bang, 0, NULL); }
+void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv){ outlet_send(x, &s_list, argc, argv); }
+void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv){ outlet_send(x, s, argc, argv); }
+
+void outlet_float(t_outlet *x, t_float f){
+    t_atom a;
+    SETFLOAT(&a, f);
+    outlet_send(x, &s_float, 1, &a);
+}
+
+void outlet_symbol(t_outlet *x, t_symbol *s){
+    t_atom a;
+    SETSYMBOL(&a, s);
+    outlet_send(x, &s_symbol, 1, &a);
+}
+
+
+/* ==== clocks ==== */
+
+struct _clock {
+    void *c_owner;
+    t_method c_fn;
+    double c_settime;
+    int c_set;
+    struct _clock *c_next;
+};
+
+static t_clock *clocklist;
+static double logicaltime;      /* in ms */
+
+t_clock *clock_new(void *owner, t_method fn){
+    t_clock *c = (t_clock *)calloc(1, sizeof(t_clock));
+    c->c_owner = owner;
+    c->c_fn = fn;
+    c->c_next = clocklist;
+    clocklist = c;
+    return c;
+}
+
+void clock_set(t_clock *x, double settime){
+    x->c_settime = settime;
+    x->c_set = 1;
+}
+
+void clock_delay(t_clock *x, double delaytime){
+    clock_set(x, logicaltime + (delaytime > 0 ? delaytime : 0));
+}
+
+void clock_unset(t_clock *x){
+    x->c_set = 0;
+}
+
+void clock_free(t_clock *x){
+    for (t_clock **link = &clocklist; *link; link = &(*link)->c_next) {
+        if (*link == x) {
+            *link = x->c_next;
+            break;
+        }
+    }
+    free(x);
+}
+
+double clock_getlogicaltime(void){ return logicaltime; }
+double clock_getsystime(void){ return logicaltime; }
+double clock_gettimesince(double prevsystime){ return logicaltime - prevsystime; }
+
+void stub_advance(double ms){
+    double end = logicaltime + ms;
+
+    for (;;) {
+        t_clock *due = NULL;
+        for (t_clock *c = clocklist; c; c = c->c_next)
+            if (c->c_set && c->c_settime <= end && (!due || c->c_settime < due->c_settime))
+                due = c;
+        if (!due)
+            break;
+        if (due->c_settime > logicaltime)
+            logicaltime = due->c_settime;
+        due->c_set = 0;
+        ((void (*)(void *))due->c_fn)(due->c_owner);
+    }
+    logicaltime = end;
+}
+
+
+/* ==== console ==== */
+
+static void stub_vpost(const char *fmt, va_list ap){
+    if (stub_verbose) {
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+    }
+}
+
+void post(const char *fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    stub_vpost(fmt, ap);
+    va_end(ap);
+}
+
+void pd_error(void *object, const char *fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    stub_vpost(fmt, ap);
+    va_end(ap);
+}
+
+void error(const char *fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    stub_vpost(fmt, ap);
+    va_end(ap);
+}
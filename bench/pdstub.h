@@ -0,0 +1,37 @@
+/* pdstub.h
+*
+* Minimal stand-in for the Pd runtime, enough to create the control objects,
+* send them messages, run their clocks and watch their outlets without a Pd
+* process. Logical time only moves when the driver advances it.
+*
+*/
+
+#ifndef PDSTUB_H
+#define PDSTUB_H
+
+#include "m_pd.h"
+
+/* called for every message that leaves a watched outlet */
+typedef void (*t_stub_outhook)(void *owner, int outno, t_symbol *s, int argc, t_atom *argv);
+
+/* instantiate a class set up with class_new() by name, as if typed into a box */
+t_object *stub_new(const char *name, int argc, t_atom *argv);
+void      stub_free(t_object *x);
+/* send "list" (or "bang" when argc is 0) */
+void      stub_list(t_object *x, int argc, t_atom *argv);
+/* send a message with a selector, e.g. stub_message(x, "flush", 0, NULL) */
+void      stub_message(t_object *x, const char *sel, int argc, t_atom *argv);
+
+void      stub_watch(t_object *x, int outno, t_stub_outhook hook, void *owner);
+long      stub_outcalls(t_object *x, int outno);
+
+/* advance logical time by ms, firing due clocks in order */
+void      stub_advance(double ms);
+
+/* getbytes()/resizebytes() calls and symbols created so far */
+long      stub_allocations(void);
+
+/* post() and friends go to stderr only when this is set */
+extern int stub_verbose;
+
+#endif
@@ -0,0 +1,591 @@
+/*
+* lslmerge object for Pure Data.
+*
+* Receives several LSL streams at once and puts them on a common time line:
+* either as one timestamp-ordered sequence of samples, tagged with the stream
+* they came from, or resampled onto a regular grid with every stream's
+* channels side by side.
+*
+* One worker thread pulls all inlets and moves the samples, with time stamps
+* already mapped onto the local clock (lsl_time_correction), into a ring per
+* stream. A single Pd clock merges the rings. Samples are held back for a
+* short latency so that late arrivals from slower streams can still be put in
+* order.
+*
+* String samples become symbols, interned only when a channel's value changes.
+* Since Pd never frees a symbol, streams with unique payloads should use byte
+* mode in the merge, where strings go out as byte values and only repeated
+* ones (see the string cache in lslpd.h) get a symbol.
+*
+*/
+
+#include "m_pd.h"      //pd header file
+#include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+
+#define DEFAULT_LATENCY_MS 100  //samples are held back this long before they are merged
+#define DEFAULT_INTERVAL_MS 5   //how often the merge runs
+#define DEFAULT_MAX_PER_TICK 1024 //most frames emitted per merge, so a backlog can't starve the scheduler
+#define CHUNK_FRAMES 512        //most samples the worker pulls from one inlet at a time
+#define RING_SLACK_SECONDS 1.0  //rings hold the latency plus this much of a stream
+#define MIN_RING_FRAMES 1024    //ring size for irregular (and very slow) streams
+#define WORKER_SLEEP 0.001      //seconds the worker sleeps when no inlet had data
+#define CORRECTION_INTERVAL 5.0 //seconds between clock offset updates
+
+/* states reported on the status outlet, per stream */
+enum { STATUS_RESOLVING, STATUS_CONNECTED, STATUS_LOST };
+static const char *status_names[] = { "resolving", "connected", "lost" };
+
+static t_class *lslmerge_class;
+
+typedef struct _lslmerge_stream{
+    t_symbol *name;
+    lsl_continuous_resolver resolver;   /* until the stream shows up */
+    lsl_streaminfo info;
+    lsl_inlet inlet;
+    const t_lslpd_format *format;
+    int nchan;
+    int status;                 /* last state reported on the status outlet */
+    int ready;                  /* set (release) once the worker may use the stream */
+    int errcode;                /* last pull error, written by the worker */
+
+    /* worker side */
+    int corrected;              /* an offset estimate has been made */
+    double offset;              /* lsl_time_correction(), added to every time stamp */
+    double next_correction;     /* lsl_local_clock() time of the next estimate */
+    void *chunk_data;           /* interleaved values in the format's C type */
+    double *chunk_timestamps;
+    t_lslpd_ring ring;          /* frame = local time stamp + nchan values */
+
+    /* grid mode: the last sample at or before the current grid point */
+    int has_prev;
+    double prev_time;
+    float *prev;                /* numeric streams */
+    float *next;                /* numeric streams: the sample after, for interpolation */
+    t_symbol **prev_sym;        /* string streams: the last value, in either mode */
+} t_lslmerge_stream;
+
+typedef struct _lslmerge{
+    t_object x_obj;
+
+    t_lslmerge_stream *streams;
+    int nstreams;
+    int nconnected;
+
+    double latency;             /* in seconds */
+    double interval;            /* in ms */
+    int max_per_tick;
+    double grid_rate;           /* 0 = timestamp-ordered merge */
+    double grid_start;          /* local time of grid point 0 */
+    double grid_count;          /* grid points emitted since grid_start */
+    int max_buffer;             /* liblsl buffer per inlet in seconds */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = sender's choice */
+    int bytes;                  /* merge mode: strings go out as byte values */
+    t_lslpd_strcache cache;
+
+    t_clock *clock;
+    double last_resolve;        /* logical time of the last look for missing streams */
+
+    /* worker thread */
+    int worker_running;
+    int worker_quit;
+    pthread_t worker;
+
+    t_atom stamp[LSLPD_STAMP_ATOMS];
+    t_atom *mergeList;          /* stream index + the widest stream's channels */
+    int mergeList_size;
+    t_atom *gridList;           /* every stream's channels, once all are connected */
+    int gridList_size;
+    t_atom *byteList;           /* byte mode: stream index + byte values, grown as needed */
+    int byteList_size;
+    t_atom statusList[2];
+
+    t_outlet *out_timestamp, *out_data, *out_status; /* outlets */
+} t_lslmerge;
+
+
+void *lslmerge_new(t_symbol *s, long argc, t_atom *argv);
+void lslmerge_free(t_lslmerge *x);
+void lslmerge_grid(t_lslmerge *x, t_floatarg f);
+void lslmerge_stringmode(t_lslmerge *x, t_symbol *s);
+static void lslmerge_tick(t_lslmerge *x);
+static void *lslmerge_worker(void *arg);
+
+
+void *lslmerge_new(t_symbol *s, long argc, t_atom *argv){
+    t_lslmerge *x = (t_lslmerge *)pd_new(lslmerge_class);
+    double latency = DEFAULT_LATENCY_MS;
+    int cache_size = LSLPD_STRCACHE_SIZE;
+
+    x->interval = DEFAULT_INTERVAL_MS;
+    x->max_per_tick = DEFAULT_MAX_PER_TICK;
+    x->max_buffer = LSLPD_MAX_BUFFER;
+
+    /* Stream names, then flags (-grid <Hz>, -latency <ms>, -interval <ms>, -maxpertick <frames>,
+       -maxbuffer <seconds>, -chunk <samples>, -bytes, -cache <strings>) */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-grid") && i + 1 < argc) {
+            x->grid_rate = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-latency") && i + 1 < argc) {
+            latency = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-interval") && i + 1 < argc) {
+            x->interval = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-maxpertick") && i + 1 < argc) {
+            x->max_per_tick = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-bytes")) {
+            x->bytes = 1;
+        } else if (!strcmp(flag, "-cache") && i + 1 < argc) {
+            cache_size = atom_getint(&argv[++i]);
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    if (!npos) {
+        pd_error(x, "lslmerge: give the names of the streams to merge");
+        return NULL;
+    }
+    x->latency = (latency < 0 ? 0 : latency) * 0.001;
+    if (x->interval < 1)
+        x->interval = 1;
+    if (x->max_per_tick < 1)
+        x->max_per_tick = 1;
+    if (x->grid_rate < 0)
+        x->grid_rate = 0;
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+    if (x->max_chunk < 0)
+        x->max_chunk = LSL_NO_PREFERENCE;
+    lslpd_strcache_init(&x->cache, cache_size);
+
+    x->nstreams = npos;
+    x->streams = (t_lslmerge_stream *)lslpd_getbytes(npos * sizeof(t_lslmerge_stream));
+    for (int i = 0; i < npos; ++i) {
+        t_lslmerge_stream *st = &x->streams[i];
+        st->name = atom_getsymbol(&argv[i]);
+        st->resolver = lslpd_resolver_new(st->name->s_name);
+        if (!st->resolver)
+            post("Problem creating the resolver for stream '%s'. It won't be found.", st->name->s_name);
+    }
+
+    x->out_timestamp = outlet_new(&x->x_obj, LSLPD_STAMP_ATOMS > 1 ? &s_list : &s_float); /* Left: timestamp */
+    x->out_data = outlet_new(&x->x_obj, &s_list);       /* Middle: data */
+    x->out_status = outlet_new(&x->x_obj, &s_list);     /* Right: stream index and connection status */
+
+    if (!pthread_create(&x->worker, NULL, lslmerge_worker, x))
+        x->worker_running = 1;
+    else
+        pd_error(x, "lslmerge: could not start the receive thread");
+
+    x->clock = clock_new(x, (t_method)lslmerge_tick);
+    clock_delay(x->clock, 0);
+    return (void *)x;
+}
+
+// Load the "lslmerge" object
+void lslmerge_setup(void) {
+  lslmerge_class = class_new(gensym("lslmerge"),
+							    (t_newmethod)lslmerge_new,
+							    (t_method)lslmerge_free,
+							    sizeof(t_lslmerge),
+							    CLASS_DEFAULT,
+							    A_GIMME,
+							   	0);
+
+  class_addmethod(lslmerge_class, (t_method)lslmerge_grid, gensym("grid"), A_FLOAT, 0);
+  class_addmethod(lslmerge_class, (t_method)lslmerge_stringmode, gensym("stringmode"), A_SYMBOL, 0);
+}
+
+// "grid <Hz>" switches to resampling onto a grid, "grid 0" back to merging
+void lslmerge_grid(t_lslmerge *x, t_floatarg f){
+    x->grid_rate = f < 0 ? 0 : f;
+    x->grid_count = 0;
+    x->grid_start = 0;
+}
+
+// "stringmode symbol" or "stringmode bytes"; grid frames always hold one symbol per string channel
+void lslmerge_stringmode(t_lslmerge *x, t_symbol *s){
+    if (!strcmp(s->s_name, "bytes"))
+        x->bytes = 1;
+    else if (!strcmp(s->s_name, "symbol"))
+        x->bytes = 0;
+    else
+        pd_error(x, "lslmerge: unknown string mode '%s' (use 'symbol' or 'bytes')", s->s_name);
+}
+
+static void lslmerge_free_strings(t_lslmerge_stream *st, char *values){
+    char **strings = (char **)values;
+    for (int k = 0; k < st->nchan; ++k)
+        lsl_destroy_string(strings[k]);
+}
+
+void lslmerge_free(t_lslmerge *x){
+    if (x->worker_running) {
+        __atomic_store_n(&x->worker_quit, 1, __ATOMIC_RELEASE);
+        pthread_join(x->worker, NULL);
+    }
+    clock_free(x->clock);
+    for (int i = 0; i < x->nstreams; ++i) {
+        t_lslmerge_stream *st = &x->streams[i];
+        size_t frames;
+        if (st->resolver)
+            lsl_destroy_continuous_resolver(st->resolver);
+        if (!st->inlet)
+            continue;
+        // release strings that were queued but never emitted
+        if (st->format->format == cft_string) {
+            while ((frames = lslpd_ring_count(&st->ring))) {
+                char *frame = (char *)lslpd_ring_readptr(&st->ring, &frames);
+                for (size_t j = 0; j < frames; ++j, frame += st->ring.framebytes)
+                    lslmerge_free_strings(st, frame + sizeof(double));
+                lslpd_ring_consume(&st->ring, frames);
+            }
+        }
+        lslpd_ring_free(&st->ring);
+        lsl_destroy_inlet(st->inlet);
+        lsl_destroy_streaminfo(st->info);
+        lslpd_freebytes(st->chunk_data, CHUNK_FRAMES * st->nchan * st->format->value_bytes);
+        lslpd_freebytes(st->chunk_timestamps, CHUNK_FRAMES * sizeof(double));
+        lslpd_freebytes(st->prev, st->nchan * sizeof(float));
+        lslpd_freebytes(st->next, st->nchan * sizeof(float));
+        lslpd_freebytes(st->prev_sym, st->nchan * sizeof(t_symbol *));
+    }
+    lslpd_freebytes(x->streams, x->nstreams * sizeof(t_lslmerge_stream));
+    if (x->mergeList)
+        lslpd_freebytes(x->mergeList, x->mergeList_size * sizeof(t_atom));
+    if (x->gridList)
+        lslpd_freebytes(x->gridList, x->gridList_size * sizeof(t_atom));
+    if (x->byteList)
+        lslpd_freebytes(x->byteList, x->byteList_size * sizeof(t_atom));
+    lslpd_strcache_free(&x->cache);
+}
+
+static void lslmerge_setstatus(t_lslmerge *x, int index, int status){
+    t_lslmerge_stream *st = &x->streams[index];
+    if (status == st->status)
+        return;
+    st->status = status;
+    SETFLOAT(x->statusList, index);
+    SETSYMBOL(x->statusList + 1, gensym(status_names[status]));
+    outlet_list(x->out_status, 0L, 2, x->statusList);
+}
+
+// create the inlet and buffers for a resolved stream (on the Pd thread, since
+// the buffers come from the pool) and hand it to the worker
+static int lslmerge_attach(t_lslmerge *x, t_lslmerge_stream *st, lsl_streaminfo info){
+    const t_lslpd_format *format = lslpd_format_get(lsl_get_channel_format(info));
+    int nchan = lsl_get_channel_count(info);
+    double rate = lsl_get_nominal_srate(info);
+    size_t frames = rate * (x->latency + RING_SLACK_SECONDS);
+
+    if (!format || nchan < 1) {
+        post("ERROR: Stream '%s' has an unsupported format or no channels", st->name->s_name);
+        return 0;
+    }
+    if (!(st->inlet = lsl_create_inlet(info, x->max_buffer, x->max_chunk, 1)))
+        return 0;
+    if (!lslpd_ring_init(&st->ring, sizeof(double) + nchan * format->value_bytes,
+            frames > MIN_RING_FRAMES ? frames : MIN_RING_FRAMES)) {
+        lsl_destroy_inlet(st->inlet);
+        st->inlet = NULL;
+        return 0;
+    }
+    st->info = info;
+    st->format = format;
+    st->nchan = nchan;
+    st->chunk_data = lslpd_getbytes(CHUNK_FRAMES * nchan * format->value_bytes);
+    st->chunk_timestamps = (double *)lslpd_getbytes(CHUNK_FRAMES * sizeof(double));
+    st->prev = (float *)lslpd_getbytes(nchan * sizeof(float));
+    st->next = (float *)lslpd_getbytes(nchan * sizeof(float));
+    st->prev_sym = (t_symbol **)lslpd_getbytes(nchan * sizeof(t_symbol *));
+
+    if (1 + nchan > x->mergeList_size) {
+        if (x->mergeList)
+            lslpd_freebytes(x->mergeList, x->mergeList_size * sizeof(t_atom));
+        x->mergeList_size = 1 + nchan;
+        x->mergeList = (t_atom *)lslpd_getbytes(x->mergeList_size * sizeof(t_atom));
+    }
+    if (++x->nconnected == x->nstreams) {
+        for (int i = 0; i < x->nstreams; ++i)
+            x->gridList_size += x->streams[i].nchan;
+        x->gridList = (t_atom *)lslpd_getbytes(x->gridList_size * sizeof(t_atom));
+    }
+    __atomic_store_n(&st->ready, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void lslmerge_resolve(t_lslmerge *x){
+    for (int i = 0; i < x->nstreams; ++i) {
+        t_lslmerge_stream *st = &x->streams[i];
+        lsl_streaminfo info;
+        if (!st->resolver || !(info = lslpd_resolver_match(st->resolver, "")))
+            continue;
+        if (!lslmerge_attach(x, st, info)) {
+            lsl_destroy_streaminfo(info);
+            continue;
+        }
+        lsl_destroy_continuous_resolver(st->resolver);
+        st->resolver = NULL;
+        post("Connected to stream '%s'.", st->name->s_name);
+        lslmerge_setstatus(x, i, STATUS_CONNECTED);
+    }
+}
+
+// worker: refresh the stream's clock offset when due, then move whatever is
+// queued in its inlet into the ring; returns the number of samples moved
+static unsigned long lslmerge_pull(t_lslmerge_stream *st){
+    size_t samplebytes = st->nchan * st->format->value_bytes;
+    char *values = (char *)st->chunk_data;
+    double now = lsl_local_clock();
+    unsigned long n;
+    size_t limit;
+    int errcode = 0;
+
+    // liblsl estimates the offset in the background; a zero timeout only picks
+    // up the latest estimate, so one slow stream can't hold up the others. If
+    // there is none yet, the last good offset stays and the next pass retries.
+    if (now >= st->next_correction) {
+        double offset = lsl_time_correction(st->inlet, 0.0, &errcode);
+        if (!errcode) {
+            st->offset = offset;
+            st->corrected = 1;
+            st->next_correction = now + CORRECTION_INTERVAL;
+        }
+    }
+    // until the offset is known the samples can't be placed; they wait in the inlet
+    if (!st->corrected)
+        return 0;
+    // the same goes for when Pd is falling behind
+    if (!(limit = lslpd_ring_space(&st->ring)))
+        return 0;
+    if (limit > CHUNK_FRAMES)
+        limit = CHUNK_FRAMES;
+    errcode = 0;
+    n = st->format->pull_chunk(st->inlet, values, st->chunk_timestamps,
+        limit * st->nchan, limit, 0.0, &errcode) / st->nchan;
+    __atomic_store_n(&st->errcode, errcode, __ATOMIC_RELAXED);
+    for (unsigned long i = 0; i < n; ) {
+        size_t frames;
+        char *frame = (char *)lslpd_ring_writeptr(&st->ring, &frames);
+        if (frames > n - i)
+            frames = n - i;
+        for (size_t j = 0; j < frames; ++j, ++i, frame += st->ring.framebytes) {
+            *(double *)frame = st->chunk_timestamps[i] + st->offset;
+            memcpy(frame + sizeof(double), values + i * samplebytes, samplebytes);
+        }
+        lslpd_ring_commit(&st->ring, frames);
+    }
+    return n;
+}
+
+static void *lslmerge_worker(void *arg){
+    t_lslmerge *x = (t_lslmerge *)arg;
+
+    while (!__atomic_load_n(&x->worker_quit, __ATOMIC_ACQUIRE)) {
+        unsigned long n = 0;
+        for (int i = 0; i < x->nstreams; ++i)
+            if (__atomic_load_n(&x->streams[i].ready, __ATOMIC_ACQUIRE))
+                n += lslmerge_pull(&x->streams[i]);
+        if (!n)
+            lslpd_sleep(WORKER_SLEEP);
+    }
+    return NULL;
+}
+
+static void lslmerge_outstamp(t_lslmerge *x, double stamp){
+    int n = lslpd_stamp_to_atoms(x->stamp, stamp);
+    if (n == 1)
+        outlet_float(x->out_timestamp, atom_getfloat(x->stamp));
+    else
+        outlet_list(x->out_timestamp, 0L, n, x->stamp);
+}
+
+// a string sample's symbol, interned only if it differs from the channel's last value
+static t_symbol *lslmerge_symbol(t_lslmerge_stream *st, int k, const char *str){
+    if (!st->prev_sym[k] || strcmp(st->prev_sym[k]->s_name, str))
+        st->prev_sym[k] = gensym(str);
+    return st->prev_sym[k];
+}
+
+// byte mode: "<stream index> <bytes...>", each channel's string as one
+// symbol (if cached) or its byte values, with channels separated by a 0;
+// returns the number of atoms
+static int lslmerge_bytes(t_lslmerge *x, int index, t_lslmerge_stream *st, char **values){
+    int natoms = 1;
+    size_t need = st->nchan;
+
+    for (int k = 0; k < st->nchan; ++k)
+        need += strlen(values[k]);
+    if (need > (size_t)x->byteList_size) {
+        if (x->byteList)
+            lslpd_freebytes(x->byteList, x->byteList_size * sizeof(t_atom));
+        x->byteList_size = need;
+        x->byteList = (t_atom *)lslpd_getbytes(need * sizeof(t_atom));
+    }
+    SETFLOAT(x->byteList, index);
+    for (int k = 0; k < st->nchan; ++k) {
+        // (SETFLOAT evaluates its atom argument twice)
+        if (k) {
+            SETFLOAT(x->byteList + natoms, 0);
+            natoms++;
+        }
+        natoms += lslpd_string_to_atoms(&x->cache, x->byteList + natoms, values[k], strlen(values[k]));
+    }
+    return natoms;
+}
+
+// timestamp-ordered merge: repeatedly emit the oldest queued sample of any
+// stream, as "<stream index> <values...>". A sample goes out once it is older
+// than the latency, or as soon as every stream has something newer queued.
+static void lslmerge_merge(t_lslmerge *x){
+    double horizon = lsl_local_clock() - x->latency;
+
+    for (int emitted = 0; emitted < x->max_per_tick; ++emitted) {
+        t_lslmerge_stream *best = NULL;
+        char *best_frame = NULL;
+        int best_index = 0, waiting = 0, natoms;
+        t_atom *list;
+
+        for (int i = 0; i < x->nstreams; ++i) {
+            t_lslmerge_stream *st = &x->streams[i];
+            size_t frames;
+            char *frame;
+            if (!st->inlet)
+                continue;
+            if (!lslpd_ring_count(&st->ring)) {
+                waiting = 1;
+                continue;
+            }
+            frame = (char *)lslpd_ring_readptr(&st->ring, &frames);
+            if (!best || *(double *)frame < *(double *)best_frame) {
+                best = st;
+                best_frame = frame;
+                best_index = i;
+            }
+        }
+        if (!best || (waiting && *(double *)best_frame > horizon))
+            break;
+
+        list = x->mergeList;
+        natoms = 1 + best->nchan;
+        SETFLOAT(x->mergeList, best_index);
+        if (best->format->to_atoms) {
+            best->format->to_atoms(x->mergeList + 1, best_frame + sizeof(double), best->nchan);
+        } else {
+            char **values = (char **)(best_frame + sizeof(double));
+            if (x->bytes) {
+                natoms = lslmerge_bytes(x, best_index, best, values);
+                list = x->byteList;
+            } else {
+                for (int k = 0; k < best->nchan; ++k)
+                    SETSYMBOL(x->mergeList + 1 + k, lslmerge_symbol(best, k, values[k]));
+            }
+            lslmerge_free_strings(best, best_frame + sizeof(double));
+        }
+        lslmerge_outstamp(x, *(double *)best_frame);
+        lslpd_ring_consume(&best->ring, 1);
+        outlet_list(x->out_data, 0L, natoms, list);
+    }
+}
+
+// grid mode: a stream's value at time t. Samples up to t are consumed into
+// prev; numeric channels are interpolated linearly towards the next sample,
+// strings hold their last value (only the last string up to t is interned).
+// Returns the number of atoms written.
+static int lslmerge_sample_at(t_lslmerge_stream *st, double t, t_atom *out){
+    size_t frames;
+    char *frame;
+    int nchan = st->nchan;
+
+    while (lslpd_ring_count(&st->ring)) {
+        frame = (char *)lslpd_ring_readptr(&st->ring, &frames);
+        if (*(double *)frame > t)
+            break;
+        if (st->format->to_float) {
+            st->format->to_float(st->prev, frame + sizeof(double), nchan);
+        } else {
+            char **values = (char **)(frame + sizeof(double));
+            char *after = lslpd_ring_count(&st->ring) > 1 ? (char *)lslpd_ring_peek(&st->ring, 1) : NULL;
+            if (!after || *(double *)after > t)
+                for (int k = 0; k < nchan; ++k)
+                    lslmerge_symbol(st, k, values[k]);
+            lslmerge_free_strings(st, frame + sizeof(double));
+        }
+        st->prev_time = *(double *)frame;
+        st->has_prev = 1;
+        lslpd_ring_consume(&st->ring, 1);
+    }
+
+    if (!st->format->to_float) {
+        for (int k = 0; k < nchan; ++k)
+            SETSYMBOL(out + k, st->prev_sym[k] ? st->prev_sym[k] : &s_);
+    } else if (st->has_prev && lslpd_ring_count(&st->ring)) {
+        frame = (char *)lslpd_ring_readptr(&st->ring, &frames);
+        double span = *(double *)frame - st->prev_time;
+        float w = span > 0 ? (t - st->prev_time) / span : 0;
+        st->format->to_float(st->next, frame + sizeof(double), nchan);
+        for (int k = 0; k < nchan; ++k)
+            SETFLOAT(out + k, st->prev[k] + w * (st->next[k] - st->prev[k]));
+    } else {
+        for (int k = 0; k < nchan; ++k)
+            SETFLOAT(out + k, st->prev[k]);
+    }
+    return nchan;
+}
+
+// grid mode: once every stream is connected, emit one frame with all channels
+// for each grid point that is older than the latency
+static void lslmerge_resample(t_lslmerge *x){
+    double horizon = lsl_local_clock() - x->latency;
+    double step = 1.0 / x->grid_rate;
+
+    if (!x->gridList)
+        return;
+    if (!x->grid_start)
+        x->grid_start = horizon;
+    for (int emitted = 0; emitted < x->max_per_tick; ++emitted) {
+        double t = x->grid_start + x->grid_count * step;
+        t_atom *out = x->gridList;
+        if (t > horizon)
+            break;
+        for (int i = 0; i < x->nstreams; ++i)
+            out += lslmerge_sample_at(&x->streams[i], t, out);
+        x->grid_count++;
+        lslmerge_outstamp(x, t);
+        outlet_list(x->out_data, 0L, x->gridList_size, x->gridList);
+    }
+}
+
+static void lslmerge_tick(t_lslmerge *x){
+    // the next tick is scheduled before emitting, since the outlets may run arbitrary code
+    clock_delay(x->clock, x->interval);
+    if (x->nconnected < x->nstreams && clock_gettimesince(x->last_resolve) >= LSLPD_RESOLVE_INTERVAL_MS) {
+        x->last_resolve = clock_getlogicaltime();
+        lslmerge_resolve(x);
+    }
+    // liblsl keeps trying to recover a lost stream; report when data flows again
+    for (int i = 0; i < x->nstreams; ++i) {
+        t_lslmerge_stream *st = &x->streams[i];
+        if (!st->inlet)
+            continue;
+        if (__atomic_load_n(&st->errcode, __ATOMIC_RELAXED) == lsl_lost_error)
+            lslmerge_setstatus(x, i, STATUS_LOST);
+        else if (lslpd_ring_count(&st->ring))
+            lslmerge_setstatus(x, i, STATUS_CONNECTED);
+    }
+    if (x->grid_rate > 0)
+        lslmerge_resample(x);
+    else
+        lslmerge_merge(x);
+}
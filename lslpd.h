@@ -0,0 +1,299 @@
+/* lslpd.h
+*
+* Helpers shared by the LSL objects for Pure Data (built into liblslpd).
+*
+*/
+
+#ifndef LSLPD_H
+#define LSLPD_H
+
+#include <stddef.h>
+#include "m_pd.h"
+#include "lsl_c.h"
+
+/* ==== frame ring ==== */
+
+/*
+* Ring of fixed-size frames (one frame = one multichannel sample, plus whatever
+* the owner wants to keep with it). The capacity is rounded up to a power of two
+* and head/tail are free-running counters, so the fill level is just head-tail.
+* Readers and writers get direct pointers into the storage so a chunk can be
+* pulled from liblsl straight into the ring without an intermediate copy.
+*
+* The ring is lock-free for one producer and one consumer thread: only the
+* producer moves head (with release semantics after the frames are written) and
+* only the consumer moves tail.
+*/
+typedef struct _lslpd_ring {
+    char *buf;
+    size_t framebytes;          /* size of one frame in bytes */
+    size_t capacity;            /* number of frames (power of two) */
+    size_t mask;
+    size_t head;                /* frames written so far */
+    size_t tail;                /* frames read so far */
+} t_lslpd_ring;
+
+int    lslpd_ring_init(t_lslpd_ring *r, size_t framebytes, size_t capacity);
+void   lslpd_ring_free(t_lslpd_ring *r);
+void   lslpd_ring_clear(t_lslpd_ring *r);
+size_t lslpd_ring_count(const t_lslpd_ring *r);
+size_t lslpd_ring_space(const t_lslpd_ring *r);
+void  *lslpd_ring_writeptr(t_lslpd_ring *r, size_t *frames);
+void   lslpd_ring_commit(t_lslpd_ring *r, size_t frames);
+void  *lslpd_ring_readptr(t_lslpd_ring *r, size_t *frames);
+void   lslpd_ring_consume(t_lslpd_ring *r, size_t frames);
+/* consumer side: the queued frame 'offset' frames past the read position */
+void  *lslpd_ring_peek(const t_lslpd_ring *r, size_t offset);
+
+
+/* ==== buffer pool ==== */
+
+/*
+* Per-object buffers (sample, chunk and atom lists) are sized by the stream's
+* channel count. They come from a pool of power-of-two blocks that keeps freed
+* blocks around for reuse, so creating and deleting many small receivers does
+* not keep going back to the system allocator. Like getbytes() the memory is
+* cleared; unlike getbytes() it may only be used from the Pd thread.
+*/
+void  *lslpd_getbytes(size_t nbytes);
+void   lslpd_freebytes(void *p, size_t nbytes);
+
+
+/* ==== logical time ==== */
+
+/*
+* Maps Pd logical time onto the LSL clock. The anchor is taken once (e.g. when
+* DSP starts) and later time stamps are derived from the logical time elapsed
+* since then, so they advance exactly with the scheduler and carry no jitter.
+* Logical time follows the audio device's clock, which drifts against the LSL
+* clock, so senders take their stamps from lslpd_timebase_stamp(): it moves the
+* anchor every LSLPD_RESYNC_INTERVAL_MS and never returns an earlier stamp.
+*/
+#define LSLPD_RESYNC_INTERVAL_MS 1000   /* logical time between re-anchorings */
+
+typedef struct _lslpd_timebase {
+    double logical;             /* Pd logical time at the anchor */
+    double lsl;                 /* lsl_local_clock() at the anchor */
+    double last;                /* last stamp handed out by lslpd_timebase_stamp() */
+} t_lslpd_timebase;
+
+void   lslpd_timebase_sync(t_lslpd_timebase *tb);
+double lslpd_timebase_now(const t_lslpd_timebase *tb);
+double lslpd_timebase_stamp(t_lslpd_timebase *tb);
+
+/* LSL time stamps are doubles (seconds since boot) and don't survive a 32-bit
+   Pd float. On such builds they go out as a hi/lo pair: hi is the stamp rounded
+   to float and lo the remainder, so t = hi + lo and differences can be taken as
+   (hi1 - hi2) + (lo1 - lo2). Double-precision builds get a single float.
+   Returns the number of atoms written (LSLPD_STAMP_ATOMS at most). */
+#if PD_FLOATSIZE == 64
+#define LSLPD_STAMP_ATOMS 1
+#else
+#define LSLPD_STAMP_ATOMS 2
+#endif
+int    lslpd_stamp_to_atoms(t_atom *av, double stamp);
+
+/* sleep the calling (non-Pd) thread */
+void   lslpd_sleep(double seconds);
+
+/* ==== runtime statistics ==== */
+
+/*
+* Durations (e.g. of a poll or a push) kept as count/sum/min/max plus a
+* histogram with power-of-two buckets in microseconds: bucket 0 is below 1 us,
+* bucket i covers [2^(i-1), 2^i) us and the last one everything longer. Adding
+* one is a few compares, so the objects collect them all the time. Reports go
+* out of a stats outlet as "<selector> <values...>", or to the console when
+* the object has none.
+*/
+#define LSLPD_TIMING_BUCKETS 16
+
+typedef struct _lslpd_timing {
+    unsigned long count;
+    double sum, min, max;       /* in seconds */
+    unsigned long hist[LSLPD_TIMING_BUCKETS];
+} t_lslpd_timing;
+
+void   lslpd_timing_clear(t_lslpd_timing *t);
+void   lslpd_timing_add(t_lslpd_timing *t, double seconds);
+void   lslpd_stats_out(t_outlet *outlet, const char *owner, const char *sel, int n, t_atom *values);
+void   lslpd_timing_out(const t_lslpd_timing *t, t_outlet *outlet, const char *owner,
+    const char *sel, const char *histsel);
+
+
+/* ==== stream resolution ==== */
+
+/*
+* Objects look for their stream with a continuous resolver (which runs in a
+* liblsl background thread) and poll it from a clock, so creating an object
+* never waits on the network. A match is a stream with the given name and,
+* unless type is empty, the given type.
+*/
+#define LSLPD_RESOLVE_INTERVAL_MS 250   /* how often pending objects check for their stream */
+
+/*
+* liblsl buffers up to this many seconds of a stream (hundreds of samples for
+* irregular streams) in each inlet and outlet; objects take -maxbuffer <s> and
+* -chunk <samples> to size the buffers and transmission chunks themselves.
+*/
+#define LSLPD_MAX_BUFFER 300
+
+lsl_continuous_resolver lslpd_resolver_new(const char *name);
+lsl_streaminfo lslpd_resolver_match(lsl_continuous_resolver res, const char *type);
+
+
+/* ==== channel formats ==== */
+
+/*
+* Everything that depends on a stream's channel format, looked up once when an
+* object is created or its stream resolved, so that the sample loops never
+* switch on the format. Samples are kept interleaved in the format's own C type
+* (value_bytes per value) and converted to and from Pd floats in bulk. The
+* string format has no converters (those are 0). Push calls take a time stamp;
+* 0.0 lets liblsl stamp the sample with the current time. The lookups return
+* NULL for formats that aren't supported (int64 where long has only 32 bits).
+*/
+typedef struct _lslpd_format {
+    lsl_channel_format_t format;
+    const char *name;           /* name used in object arguments, e.g. "int16" */
+    const char *alias;          /* accepted as well, e.g. "short" */
+    size_t value_bytes;
+    unsigned long (*pull_chunk)(lsl_inlet in, void *data, double *timestamps,
+        unsigned long elements, unsigned long frames, double timeout, int *ec);
+    int  (*push_sample)(lsl_outlet out, void *data, double timestamp);
+    int  (*push_chunk)(lsl_outlet out, void *data, unsigned long elements, double timestamp);
+    int  (*push_chunk_n)(lsl_outlet out, void *data, unsigned long elements, double *timestamps);
+    void (*to_float)(float *dst, const void *src, size_t n);
+    void (*to_atoms)(t_atom *dst, const void *src, int n);
+    void (*from_atoms)(void *dst, const t_atom *src, int n);
+} t_lslpd_format;
+
+const t_lslpd_format *lslpd_format_byname(const char *name);
+const t_lslpd_format *lslpd_format_get(lsl_channel_format_t format);
+
+/* ==== string symbols ==== */
+
+/*
+* Pd never frees a symbol, so turning every string of a marker stream with
+* unique payloads into one grows the symbol table without bound. Instead a
+* string can go out as its byte values, and only strings that come in again
+* while still in a small LRU cache (and are at most LSLPD_STRCACHE_MAX_LENGTH
+* bytes long) get a symbol. Pd thread only, as the entries come from the pool.
+*/
+#define LSLPD_STRCACHE_SIZE 32          /* default number of strings remembered */
+#define LSLPD_STRCACHE_MAX_LENGTH 64    /* longer strings always go out as bytes */
+
+typedef struct _lslpd_strcache_entry {
+    char *str;
+    size_t len;
+    unsigned int hash;
+    t_symbol *sym;              /* set once the string has come in a second time */
+    unsigned long used;         /* cache clock at the last hit, for LRU eviction */
+} t_lslpd_strcache_entry;
+
+typedef struct _lslpd_strcache {
+    t_lslpd_strcache_entry *entries;    /* allocated on first use */
+    int size;                           /* 0 = never give out symbols */
+    unsigned long clock;
+} t_lslpd_strcache;
+
+void   lslpd_strcache_init(t_lslpd_strcache *c, int size);
+void   lslpd_strcache_free(t_lslpd_strcache *c);
+/* the symbol for a string that came in before and is still cached, or NULL
+   if it should go out as bytes; misses replace the least recently used entry */
+t_symbol *lslpd_strcache_lookup(t_lslpd_strcache *c, const char *str, size_t len);
+/* write a string as one cached symbol or its byte values; returns the number
+   of atoms written (at most len, or 1) */
+int    lslpd_string_to_atoms(t_lslpd_strcache *c, t_atom *dst, const char *str, size_t len);
+
+
+/* ==== vector kernels ==== */
+
+/*
+* Bulk conversions used on every sample of wide streams. Each runs an AVX2,
+* SSE2 or plain C version, whichever is the best the CPU supports (see
+* lslpd_simd_name()). (De)interleaving works between one interleaved float
+* chunk and nchan signal vectors; offset is where in the vectors to start.
+* lslpd_mac() adds w times src to acc, e.g. one weighted frame across all its
+* channels. lslpd_biquads() runs interleaved frames in place through a cascade
+* of biquad sections, vectorized across the channels of each frame.
+*/
+const char *lslpd_simd_name(void);
+void   lslpd_s16_to_float(float *dst, const short *src, size_t n);
+void   lslpd_s32_to_float(float *dst, const int *src, size_t n);
+void   lslpd_f64_to_float(float *dst, const double *src, size_t n);
+void   lslpd_float_to_atoms(t_atom *dst, const float *src, size_t n);
+void   lslpd_atoms_to_float(float *dst, const t_atom *src, size_t n);
+void   lslpd_deinterleave(t_sample **out, size_t offset, const float *src, int nchan, size_t frames);
+void   lslpd_interleave(float *dst, t_sample **in, int nchan, size_t frames);
+void   lslpd_mac(float *acc, const float *src, float w, size_t n);
+void   lslpd_biquads(float *frames, size_t n, int nchan, const float *coefs, int nsections,
+    float *state);
+
+
+/* ==== fractional resampling ==== */
+
+/*
+* Windowed-sinc interpolation between the samples of an interleaved stream, for
+* playing it at another rate. A frame at fractional position frac (0 <= frac < 1)
+* past frame HALF-1 is computed from LSLPD_RESAMPLE_TAPS consecutive frames,
+* HALF = TAPS/2 on either side. The kernel is designed for a resampling step (input
+* samples per output sample) and only redesigned when that changes; small changes
+* of the step at run time, like drift correction, need no new design.
+*/
+#define LSLPD_RESAMPLE_TAPS 16
+#define LSLPD_RESAMPLE_PHASES 128   /* tabulated offsets between two samples */
+
+typedef struct _lslpd_resampler {
+    float *table;               /* PHASES+1 rows of TAPS weights */
+    double step;                /* the step the table was designed for */
+} t_lslpd_resampler;
+
+int    lslpd_resampler_init(t_lslpd_resampler *r);
+void   lslpd_resampler_free(t_lslpd_resampler *r);
+void   lslpd_resampler_design(t_lslpd_resampler *r, double step);
+void   lslpd_resampler_frame(const t_lslpd_resampler *r, float *out, const float *const *frames,
+    int nchan, double frac);
+
+
+/* ==== filter banks ==== */
+
+/*
+* The same filter on every channel of an interleaved float stream, applied in
+* place chunk by chunk: a cascade of biquad sections followed by one FIR. It is
+* described by a list of stages, each a keyword and its numbers, frequencies in
+* Hz of the stream's nominal rate, defaults in parentheses:
+*
+*   lowpass <f> [<order>]           Butterworth, order rounded up to even (4)
+*   highpass <f> [<order>]
+*   bandpass <lo> <hi> [<order>]    a highpass at lo followed by a lowpass at hi
+*   notch <f> [<q>]                 (30)
+*   biquad <b0> <b1> <b2> <a1> <a2> coefficients as they are, a0 = 1
+*   fir lowpass|highpass <f> [<taps>]           Hamming-windowed sinc, taps
+*   fir bandpass|bandstop <lo> <hi> [<taps>]    rounded up to odd (65)
+*   fir <h0> <h1> ...               taps as they are
+*
+* All the biquads run first, in the order given, then all the FIR stages
+* convolved into one. Filters are allocated with getbytes(), not the pool, as
+* the receive threads may run and replace them.
+*/
+#define LSLPD_FIR_BLOCK 64      /* frames the FIR stage works on at a time */
+
+typedef struct _lslpd_filter {
+    int nchan;
+    int nsections;
+    float *coefs;               /* b0 b1 b2 a1 a2 per section */
+    float *state;               /* z1 then z2 of every channel, per section */
+    int ntaps;                  /* 0 without a FIR stage */
+    float *taps;
+    float *history;             /* the last ntaps-1 input frames, then a block */
+} t_lslpd_filter;
+
+/* both fail (returning 0 or NULL) with an error posted if the description is wrong */
+int    lslpd_filter_check(int argc, const t_atom *argv, void *owner, const char *name);
+t_lslpd_filter *lslpd_filter_new(int argc, const t_atom *argv, int nchan, double rate,
+    void *owner, const char *name);
+void   lslpd_filter_free(t_lslpd_filter *f);
+void   lslpd_filter_run(t_lslpd_filter *f, float *frames, size_t n);
+
+#endif
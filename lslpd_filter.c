@@ -0,0 +1,361 @@
+/* lslpd_filter.c
+*
+* Filter banks for interleaved float streams: parsing a filter description,
+* designing its biquads (bilinear transform, as in the RBJ audio EQ cookbook)
+* and FIR taps (windowed sinc), and running chunks through them. The per-frame
+* work is lslpd_biquads() and lslpd_mac(), both across all the channels of a
+* frame at once.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DEFAULT_ORDER 4
+#define MAX_ORDER 16
+#define DEFAULT_Q 30
+#define DEFAULT_TAPS 65
+#define MAX_TAPS 4096
+#define DENORMAL 1e-30f         //biquad states below this are flushed to 0 after each chunk
+#define PI 3.14159265358979323846
+
+/* what parsing a description adds up to; design is NULL when only counting */
+typedef struct _filter_parse {
+    void *owner;
+    const char *name;
+    double rate;
+    int nsections;
+    int nfir;                   /* FIR stages */
+    int ntaps;                  /* of the FIR stages convolved, 1 before the first */
+    t_lslpd_filter *design;
+    double *fir;                /* the convolution so far, ntaps long */
+} t_filter_parse;
+
+static int filter_is(const t_atom *a, const char *s){
+    return a->a_type == A_SYMBOL && !strcmp(a->a_w.w_symbol->s_name, s);
+}
+
+// frequencies only make sense for a regular stream, and below its Nyquist rate
+static int filter_frequency(t_filter_parse *p, const char *stage, double f){
+    if (!p->design)
+        return 1;
+    if (p->rate <= 0) {
+        pd_error(p->owner, "%s: %s needs a stream with a nominal rate", p->name, stage);
+        return 0;
+    }
+    if (f <= 0 || f >= p->rate / 2) {
+        pd_error(p->owner, "%s: %s: %g Hz is not between 0 and %g Hz", p->name, stage,
+            f, p->rate / 2);
+        return 0;
+    }
+    return 1;
+}
+
+static void filter_section(t_filter_parse *p, double b0, double b1, double b2, double a0,
+    double a1, double a2){
+    if (p->design) {
+        float *c = p->design->coefs + 5 * p->nsections;
+        c[0] = (float)(b0 / a0);
+        c[1] = (float)(b1 / a0);
+        c[2] = (float)(b2 / a0);
+        c[3] = (float)(a1 / a0);
+        c[4] = (float)(a2 / a0);
+    }
+    p->nsections++;
+}
+
+// a Butterworth lowpass or highpass of even order as order/2 sections, each a
+// conjugate pole pair with its own Q
+static void filter_butterworth(t_filter_parse *p, int highpass, double f, int order){
+    for (int k = 0; k < order / 2; ++k) {
+        double q = 1 / (2 * sin((2 * k + 1) * PI / (2 * order)));
+        double w = 2 * PI * f / (p->rate > 0 ? p->rate : 1), cw = cos(w);
+        double alpha = sin(w) / (2 * q);
+        double g = highpass ? (1 + cw) / 2 : (1 - cw) / 2;
+        filter_section(p, g, highpass ? -2 * g : 2 * g, g, 1 + alpha, -2 * cw, 1 - alpha);
+    }
+}
+
+static void filter_notch(t_filter_parse *p, double f, double q){
+    double w = 2 * PI * f / (p->rate > 0 ? p->rate : 1), cw = cos(w);
+    double alpha = sin(w) / (2 * q);
+    filter_section(p, 1, -2 * cw, 1, 1 + alpha, -2 * cw, 1 - alpha);
+}
+
+// windowed sinc with its passband gain normalized to 1; highpass and bandstop
+// are a delta minus the complementary lowpass and bandpass
+static void filter_sinc(double *h, int n, double rate, const char *kind, double lo, double hi){
+    int m = n / 2, stop = !strcmp(kind, "highpass") || !strcmp(kind, "bandstop");
+    double sum = 0;
+
+    if (!strcmp(kind, "highpass"))
+        hi = lo, lo = 0;
+    else if (!strcmp(kind, "lowpass"))
+        lo = 0;
+    for (int i = 0; i < n; ++i) {
+        double d = i - m, window = 0.54 - 0.46 * cos(2 * PI * i / (n - 1));
+        double a = 2 * hi / rate, b = 2 * lo / rate;
+        h[i] = window * (d == 0 ? a - b : (sin(PI * a * d) - sin(PI * b * d)) / (PI * d));
+    }
+    // gain at DC for a lowpass, at the band's centre for a bandpass
+    for (int i = 0; i < n; ++i)
+        sum += h[i] * cos(PI * (lo + hi) / rate * (i - m) * (lo > 0));
+    for (int i = 0; i < n; ++i)
+        h[i] = (stop ? -h[i] : h[i]) / sum;
+    if (stop)
+        h[m] += 1;
+}
+
+static void filter_convolve(t_filter_parse *p, const double *h, int n){
+    if (p->design) {
+        double *acc = p->fir;
+        int len = p->ntaps + n - 1;
+        // in place from the end: acc[i - j] for j >= 0 is still the old value
+        for (int i = len - 1; i >= 0; --i) {
+            double sum = 0;
+            for (int j = 0; j < n; ++j)
+                if (i - j >= 0 && i - j < p->ntaps)
+                    sum += h[j] * acc[i - j];
+            acc[i] = sum;
+        }
+    }
+    p->ntaps += n - 1;
+    p->nfir++;
+}
+
+static int filter_fir(t_filter_parse *p, int argc, const t_atom *argv){
+    const char *kind = argc && argv->a_type == A_SYMBOL ? argv->a_w.w_symbol->s_name : NULL;
+    int bands = kind && (!strcmp(kind, "bandpass") || !strcmp(kind, "bandstop")) ? 2 : 1;
+    double lo, hi, *h;
+    int n;
+
+    if (!kind) {
+        // the taps themselves
+        if (!argc) {
+            pd_error(p->owner, "%s: fir: no taps", p->name);
+            return 0;
+        }
+        if (p->design) {
+            if (!(h = (double *)getbytes(argc * sizeof(double))))
+                return 0;
+            for (int i = 0; i < argc; ++i)
+                h[i] = atom_getfloat(argv + i);
+            filter_convolve(p, h, argc);
+            freebytes(h, argc * sizeof(double));
+        } else
+            filter_convolve(p, NULL, argc);
+        return 1;
+    }
+    if (strcmp(kind, "lowpass") && strcmp(kind, "highpass") && bands == 1) {
+        pd_error(p->owner, "%s: fir: unknown type '%s'", p->name, kind);
+        return 0;
+    }
+    if (argc < 1 + bands || argc > 2 + bands) {
+        pd_error(p->owner, "%s: fir %s takes %s [<taps>]", p->name, kind,
+            bands == 2 ? "<lo> <hi>" : "<frequency>");
+        return 0;
+    }
+    lo = atom_getfloat(argv + 1);
+    hi = bands == 2 ? atom_getfloat(argv + 2) : lo;
+    n = argc > 1 + bands ? (int)atom_getfloat(argv + 1 + bands) : DEFAULT_TAPS;
+    n |= 1;
+    if (n < 3 || n > MAX_TAPS) {
+        pd_error(p->owner, "%s: fir %s: taps must be between 3 and %d", p->name, kind, MAX_TAPS);
+        return 0;
+    }
+    if (bands == 2 && lo >= hi) {
+        pd_error(p->owner, "%s: fir %s: %g Hz is not below %g Hz", p->name, kind, lo, hi);
+        return 0;
+    }
+    if (!filter_frequency(p, kind, lo) || !filter_frequency(p, kind, hi))
+        return 0;
+    if (p->design) {
+        if (!(h = (double *)getbytes(n * sizeof(double))))
+            return 0;
+        filter_sinc(h, n, p->rate, kind, lo, hi);
+        filter_convolve(p, h, n);
+        freebytes(h, n * sizeof(double));
+    } else
+        filter_convolve(p, NULL, n);
+    return 1;
+}
+
+static int filter_stage(t_filter_parse *p, const char *stage, int argc, const t_atom *argv){
+    int order;
+
+    if (!strcmp(stage, "fir"))
+        return filter_fir(p, argc, argv);
+    for (int i = 0; i < argc; ++i)
+        if (argv[i].a_type != A_FLOAT) {
+            pd_error(p->owner, "%s: %s takes numbers", p->name, stage);
+            return 0;
+        }
+    if (!strcmp(stage, "lowpass") || !strcmp(stage, "highpass") || !strcmp(stage, "bandpass")) {
+        int bands = !strcmp(stage, "bandpass") ? 2 : 1;
+        double lo, hi;
+        if (argc < bands || argc > bands + 1) {
+            pd_error(p->owner, "%s: %s takes %s [<order>]", p->name, stage,
+                bands == 2 ? "<lo> <hi>" : "<frequency>");
+            return 0;
+        }
+        lo = atom_getfloat(argv);
+        hi = bands == 2 ? atom_getfloat(argv + 1) : lo;
+        order = argc > bands ? (int)atom_getfloat(argv + bands) : DEFAULT_ORDER;
+        order += order & 1;
+        if (order < 2 || order > MAX_ORDER) {
+            pd_error(p->owner, "%s: %s: order must be between 1 and %d", p->name, stage, MAX_ORDER);
+            return 0;
+        }
+        if (bands == 2 && lo >= hi) {
+            pd_error(p->owner, "%s: %s: %g Hz is not below %g Hz", p->name, stage, lo, hi);
+            return 0;
+        }
+        if (!filter_frequency(p, stage, lo) || !filter_frequency(p, stage, hi))
+            return 0;
+        if (bands == 2) {
+            filter_butterworth(p, 1, lo, order);
+            filter_butterworth(p, 0, hi, order);
+        } else
+            filter_butterworth(p, !strcmp(stage, "highpass"), lo, order);
+    } else if (!strcmp(stage, "notch")) {
+        double q = argc > 1 ? atom_getfloat(argv + 1) : DEFAULT_Q;
+        if (argc < 1 || argc > 2 || q <= 0) {
+            pd_error(p->owner, "%s: notch takes <frequency> [<q>], q above 0", p->name);
+            return 0;
+        }
+        if (!filter_frequency(p, stage, atom_getfloat(argv)))
+            return 0;
+        filter_notch(p, atom_getfloat(argv), q);
+    } else if (!strcmp(stage, "biquad")) {
+        if (argc != 5) {
+            pd_error(p->owner, "%s: biquad takes <b0> <b1> <b2> <a1> <a2>", p->name);
+            return 0;
+        }
+        filter_section(p, atom_getfloat(argv), atom_getfloat(argv + 1), atom_getfloat(argv + 2),
+            1, atom_getfloat(argv + 3), atom_getfloat(argv + 4));
+    } else {
+        pd_error(p->owner, "%s: unknown filter '%s'", p->name, stage);
+        return 0;
+    }
+    return 1;
+}
+
+// a stage runs from its keyword to the next keyword; fir takes a type keyword
+static int filter_parse(t_filter_parse *p, int argc, const t_atom *argv){
+    int i = 0;
+
+    p->nsections = 0;
+    p->nfir = 0;
+    p->ntaps = 1;
+    if (p->fir)
+        p->fir[0] = 1;
+    while (i < argc) {
+        const char *stage;
+        int n = 1;
+        if (argv[i].a_type != A_SYMBOL) {
+            pd_error(p->owner, "%s: filter: expected a filter type, not a number", p->name);
+            return 0;
+        }
+        stage = argv[i].a_w.w_symbol->s_name;
+        if (filter_is(argv + i, "fir") && i + 1 < argc && argv[i + 1].a_type == A_SYMBOL)
+            n++;
+        while (i + n < argc && argv[i + n].a_type != A_SYMBOL)
+            n++;
+        if (!filter_stage(p, stage, n - 1, argv + i + 1))
+            return 0;
+        i += n;
+    }
+    if (p->ntaps > MAX_TAPS) {
+        pd_error(p->owner, "%s: fir: more than %d taps altogether", p->name, MAX_TAPS);
+        return 0;
+    }
+    return 1;
+}
+
+int lslpd_filter_check(int argc, const t_atom *argv, void *owner, const char *name){
+    t_filter_parse p = { owner, name, 0, 0, 0, 1, NULL, NULL };
+    return filter_parse(&p, argc, argv);
+}
+
+t_lslpd_filter *lslpd_filter_new(int argc, const t_atom *argv, int nchan, double rate,
+    void *owner, const char *name){
+    t_filter_parse p = { owner, name, rate, 0, 0, 1, NULL, NULL };
+    t_lslpd_filter *f;
+
+    if (!filter_parse(&p, argc, argv) || nchan < 1)
+        return NULL;
+    if (!(f = (t_lslpd_filter *)getbytes(sizeof(*f))))
+        return NULL;
+    f->nchan = nchan;
+    f->nsections = p.nsections;
+    f->ntaps = p.nfir ? p.ntaps : 0;
+    f->coefs = (float *)getbytes((5 * f->nsections + 1) * sizeof(float));
+    f->state = (float *)getbytes((2 * f->nsections * nchan + 1) * sizeof(float));
+    f->taps = (float *)getbytes((f->ntaps + 1) * sizeof(float));
+    f->history = (float *)getbytes(((size_t)f->ntaps + LSLPD_FIR_BLOCK) * nchan * sizeof(float));
+    p.fir = (double *)getbytes(p.ntaps * sizeof(double));
+    p.design = f;
+    if (!f->coefs || !f->state || !f->taps || !f->history || !p.fir || !filter_parse(&p, argc, argv)) {
+        if (p.fir)
+            freebytes(p.fir, p.ntaps * sizeof(double));
+        lslpd_filter_free(f);
+        return NULL;
+    }
+    for (int t = 0; t < f->ntaps; ++t)
+        f->taps[t] = (float)p.fir[t];
+    freebytes(p.fir, p.ntaps * sizeof(double));
+    return f;
+}
+
+void lslpd_filter_free(t_lslpd_filter *f){
+    if (!f)
+        return;
+    if (f->coefs)
+        freebytes(f->coefs, (5 * f->nsections + 1) * sizeof(float));
+    if (f->state)
+        freebytes(f->state, (2 * f->nsections * f->nchan + 1) * sizeof(float));
+    if (f->taps)
+        freebytes(f->taps, (f->ntaps + 1) * sizeof(float));
+    if (f->history)
+        freebytes(f->history, ((size_t)f->ntaps + LSLPD_FIR_BLOCK) * f->nchan * sizeof(float));
+    freebytes(f, sizeof(*f));
+}
+
+// the FIR works on blocks appended to the last ntaps-1 input frames: frame i of
+// a block is the sum over the taps of taps[t] times the frame t before it
+static void filter_fir_run(t_lslpd_filter *f, float *frames, size_t n){
+    int nchan = f->nchan, past = f->ntaps - 1;
+
+    while (n) {
+        size_t block = n < LSLPD_FIR_BLOCK ? n : LSLPD_FIR_BLOCK;
+        float *in = f->history + (size_t)past * nchan;
+        memcpy(in, frames, block * nchan * sizeof(float));
+        for (size_t i = 0; i < block; ++i) {
+            float *out = frames + i * nchan;
+            memset(out, 0, nchan * sizeof(float));
+            for (int t = 0; t < f->ntaps; ++t)
+                lslpd_mac(out, in + ((ptrdiff_t)i - t) * nchan, f->taps[t], nchan);
+        }
+        memmove(f->history, f->history + block * nchan, (size_t)past * nchan * sizeof(float));
+        frames += block * nchan;
+        n -= block;
+    }
+}
+
+void lslpd_filter_run(t_lslpd_filter *f, float *frames, size_t n){
+    if (!n)
+        return;
+    if (f->nsections) {
+        int nstate = 2 * f->nsections * f->nchan;
+        lslpd_biquads(frames, n, f->nchan, f->coefs, f->nsections, f->state);
+        // decaying states would otherwise go denormal in silence, and slow
+        for (int i = 0; i < nstate; ++i)
+            if (fabsf(f->state[i]) < DENORMAL)
+                f->state[i] = 0;
+    }
+    if (f->ntaps)
+        filter_fir_run(f, frames, n);
+}
@@ -0,0 +1,213 @@
+/* lslpd_format.c
+*
+* Per channel format pull/push and conversion routines. Each numeric format
+* gets its own set, generated from one template, so converting a chunk is a
+* plain loop over values of a known C type. Formats with a vector kernel
+* (float32, double64, int32, int16) convert through those instead. String
+* samples can go out as byte lists, with a small cache of repeated strings.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <string.h>
+
+/*
+* F:  function suffix in the liblsl API (lsl_pull_chunk_F, lsl_push_sample_Ft, ...)
+* A:  C type liblsl uses for the format in its API
+*/
+#define FORMAT_IO(F, A) \
+static unsigned long pull_chunk_##F(lsl_inlet in, void *data, double *timestamps, \
+    unsigned long elements, unsigned long frames, double timeout, int *ec){ \
+    return lsl_pull_chunk_##F(in, (A *)data, timestamps, elements, frames, timeout, ec); \
+} \
+static int push_sample_##F(lsl_outlet out, void *data, double timestamp){ \
+    return lsl_push_sample_##F##t(out, (A *)data, timestamp); \
+} \
+static int push_chunk_##F(lsl_outlet out, void *data, unsigned long elements, double timestamp){ \
+    return lsl_push_chunk_##F##t(out, (A *)data, elements, timestamp); \
+} \
+static int push_chunk_n_##F(lsl_outlet out, void *data, unsigned long elements, double *timestamps){ \
+    return lsl_push_chunk_##F##tn(out, (A *)data, elements, timestamps); \
+}
+
+// atoms to values, rounding for the integer formats (INT = 1)
+#define FORMAT_FROM_ATOMS(F, T, INT) \
+static void from_atoms_##F(void *dst, const t_atom *src, int n){ \
+    T *out = (T *)dst; \
+    for (int i = 0; i < n; ++i) { \
+        t_float f = atom_getfloat((t_atom *)src + i); \
+        out[i] = (T)(INT ? (f < 0 ? f - 0.5 : f + 0.5) : f); \
+    } \
+}
+
+// plain conversion loops, for the formats without a vector kernel
+#define FORMAT_CONVERT(F, T) \
+static void to_float_##F(float *dst, const void *src, size_t n){ \
+    const T *in = (const T *)src; \
+    for (size_t i = 0; i < n; ++i) \
+        dst[i] = (float)in[i]; \
+} \
+static void to_atoms_##F(t_atom *dst, const void *src, int n){ \
+    const T *in = (const T *)src; \
+    for (int i = 0; i < n; ++i) \
+        SETFLOAT(dst + i, (t_float)in[i]); \
+}
+
+// vector kernel to float, then (in blocks, through the stack) float to atoms
+#define ATOMS_BLOCK 64
+#define FORMAT_KERNEL(F, T, KERNEL) \
+static void to_float_##F(float *dst, const void *src, size_t n){ \
+    KERNEL(dst, (const T *)src, n); \
+} \
+static void to_atoms_##F(t_atom *dst, const void *src, int n){ \
+    const T *in = (const T *)src; \
+    float block[ATOMS_BLOCK]; \
+    for (int i = 0; i < n; i += ATOMS_BLOCK) { \
+        int m = n - i < ATOMS_BLOCK ? n - i : ATOMS_BLOCK; \
+        KERNEL(block, in + i, m); \
+        lslpd_float_to_atoms(dst + i, block, m); \
+    } \
+}
+
+FORMAT_IO(f, float)
+FORMAT_IO(d, double)
+FORMAT_IO(i, int)
+FORMAT_IO(s, short)
+FORMAT_IO(c, char)
+FORMAT_IO(l, long)      // the C API has no int64_t calls; int64 is only offered where long has 64 bits
+
+// int8 values are read as signed char, since plain char may be unsigned
+FORMAT_FROM_ATOMS(d, double, 0)
+FORMAT_FROM_ATOMS(i, int, 1)
+FORMAT_FROM_ATOMS(s, short, 1)
+FORMAT_FROM_ATOMS(c, signed char, 1)
+FORMAT_FROM_ATOMS(l, long, 1)
+
+FORMAT_KERNEL(d, double, lslpd_f64_to_float)
+FORMAT_KERNEL(i, int, lslpd_s32_to_float)
+FORMAT_KERNEL(s, short, lslpd_s16_to_float)
+FORMAT_CONVERT(c, signed char)
+FORMAT_CONVERT(l, long)
+
+static void to_float_f(float *dst, const void *src, size_t n){
+    memcpy(dst, src, n * sizeof(float));
+}
+static void to_atoms_f(t_atom *dst, const void *src, int n){
+    lslpd_float_to_atoms(dst, (const float *)src, n);
+}
+static void from_atoms_f(void *dst, const t_atom *src, int n){
+    lslpd_atoms_to_float((float *)dst, src, n);
+}
+
+static unsigned long pull_chunk_str(lsl_inlet in, void *data, double *timestamps,
+    unsigned long elements, unsigned long frames, double timeout, int *ec){
+    return lsl_pull_chunk_str(in, (char **)data, timestamps, elements, frames, timeout, ec);
+}
+static int push_sample_str(lsl_outlet out, void *data, double timestamp){
+    return lsl_push_sample_strt(out, (char **)data, timestamp);
+}
+static int push_chunk_str(lsl_outlet out, void *data, unsigned long elements, double timestamp){
+    return lsl_push_chunk_strt(out, (char **)data, elements, timestamp);
+}
+static int push_chunk_n_str(lsl_outlet out, void *data, unsigned long elements, double *timestamps){
+    return lsl_push_chunk_strtn(out, (char **)data, elements, timestamps);
+}
+
+#define NUMERIC(F) pull_chunk_##F, push_sample_##F, push_chunk_##F, push_chunk_n_##F, \
+    to_float_##F, to_atoms_##F, from_atoms_##F
+
+static const t_lslpd_format formats[] = {
+    { cft_float32,  "float32",  "float",  sizeof(float),       NUMERIC(f) },
+    { cft_double64, "double64", "double", sizeof(double),      NUMERIC(d) },
+    { cft_string,   "string",   "string32", sizeof(char *),
+        pull_chunk_str, push_sample_str, push_chunk_str, push_chunk_n_str, 0, 0, 0 },
+    { cft_int32,    "int32",    "int",    sizeof(int),         NUMERIC(i) },
+    { cft_int16,    "int16",    "short",  sizeof(short),       NUMERIC(s) },
+    { cft_int8,     "int8",     "char",   sizeof(char),        NUMERIC(c) },
+    { cft_int64,    "int64",    "long",   sizeof(long),        NUMERIC(l) },
+};
+#define NFORMATS (sizeof(formats) / sizeof(formats[0]))
+
+// int64 goes through liblsl's long calls, and long has only 32 bits on Windows:
+// buffers sized for it would hold half a sample, so the format is unsupported there
+static int format_available(const t_lslpd_format *f){
+    return f->format != cft_int64 || sizeof(long) >= 8;
+}
+
+const t_lslpd_format *lslpd_format_byname(const char *name){
+    for (size_t i = 0; i < NFORMATS; ++i)
+        if ((!strcmp(name, formats[i].name) || !strcmp(name, formats[i].alias)) && format_available(&formats[i]))
+            return &formats[i];
+    return NULL;
+}
+
+const t_lslpd_format *lslpd_format_get(lsl_channel_format_t format){
+    for (size_t i = 0; i < NFORMATS; ++i)
+        if (formats[i].format == format && format_available(&formats[i]))
+            return &formats[i];
+    return NULL;
+}
+
+void lslpd_strcache_init(t_lslpd_strcache *c, int size){
+    c->entries = NULL;
+    c->size = size < 0 ? 0 : size;
+    c->clock = 0;
+}
+
+void lslpd_strcache_free(t_lslpd_strcache *c){
+    if (!c->entries)
+        return;
+    for (int i = 0; i < c->size; ++i)
+        if (c->entries[i].str)
+            lslpd_freebytes(c->entries[i].str, c->entries[i].len + 1);
+    lslpd_freebytes(c->entries, c->size * sizeof(t_lslpd_strcache_entry));
+    c->entries = NULL;
+}
+
+t_symbol *lslpd_strcache_lookup(t_lslpd_strcache *c, const char *str, size_t len){
+    t_lslpd_strcache_entry *e, *victim;
+    unsigned int hash = 5381;
+
+    if (!c->size || len > LSLPD_STRCACHE_MAX_LENGTH)
+        return NULL;
+    if (!c->entries)
+        c->entries = (t_lslpd_strcache_entry *)lslpd_getbytes(c->size * sizeof(t_lslpd_strcache_entry));
+    for (size_t i = 0; i < len; ++i)
+        hash = hash * 33 + (unsigned char)str[i];
+
+    victim = c->entries;
+    c->clock++;
+    for (e = c->entries; e < c->entries + c->size; ++e) {
+        if (e->str && e->hash == hash && e->len == len && !memcmp(e->str, str, len)) {
+            e->used = c->clock;
+            if (!e->sym)
+                e->sym = gensym(e->str);
+            return e->sym;
+        }
+        if (!e->str || (victim->str && e->used < victim->used))
+            victim = e;
+    }
+    if (victim->str)
+        lslpd_freebytes(victim->str, victim->len + 1);
+    victim->str = (char *)lslpd_getbytes(len + 1);
+    memcpy(victim->str, str, len);
+    victim->len = len;
+    victim->hash = hash;
+    victim->sym = NULL;
+    victim->used = c->clock;
+    return NULL;
+}
+
+int lslpd_string_to_atoms(t_lslpd_strcache *c, t_atom *dst, const char *str, size_t len){
+    const unsigned char *bytes = (const unsigned char *)str;
+    t_symbol *sym = lslpd_strcache_lookup(c, str, len);
+    // (SETFLOAT/SETSYMBOL evaluate their atom argument twice)
+    if (sym) {
+        SETSYMBOL(dst, sym);
+        return 1;
+    }
+    for (size_t i = 0; i < len; ++i)
+        SETFLOAT(dst + i, bytes[i]);
+    return (int)len;
+}
@@ -0,0 +1,65 @@
+/* lslpd_pool.c
+*
+* Pool of power-of-two blocks for the per-object buffers. Freed blocks are
+* kept on a free list per size class (the link lives in the block itself) up
+* to POOL_KEEP blocks, and anything bigger than the largest class goes
+* straight to getbytes().
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <string.h>
+
+#define POOL_MIN_SHIFT 6        //smallest block is 64 bytes
+#define POOL_MAX_SHIFT 20       //largest pooled block is 1 MB
+#define POOL_NCLASS (POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+#define POOL_KEEP 64            //free blocks kept per size class
+
+typedef struct _pool_block {
+    struct _pool_block *next;
+} t_pool_block;
+
+static t_pool_block *pool_free[POOL_NCLASS];
+static int pool_nfree[POOL_NCLASS];
+
+// size class for a request, or -1 if it is too big to pool
+static int pool_class(size_t nbytes){
+    int c = 0;
+    while (((size_t)1 << (c + POOL_MIN_SHIFT)) < nbytes)
+        if (++c >= POOL_NCLASS)
+            return -1;
+    return c;
+}
+
+void *lslpd_getbytes(size_t nbytes){
+    int c = pool_class(nbytes);
+    t_pool_block *b;
+
+    if (c < 0)
+        return getbytes(nbytes);
+    if ((b = pool_free[c])) {
+        pool_free[c] = b->next;
+        pool_nfree[c]--;
+        memset(b, 0, (size_t)1 << (c + POOL_MIN_SHIFT));
+        return b;
+    }
+    return getbytes((size_t)1 << (c + POOL_MIN_SHIFT));
+}
+
+void lslpd_freebytes(void *p, size_t nbytes){
+    int c = pool_class(nbytes);
+    t_pool_block *b = (t_pool_block *)p;
+
+    if (!p)
+        return;
+    if (c < 0) {
+        freebytes(p, nbytes);
+    } else if (pool_nfree[c] >= POOL_KEEP) {
+        freebytes(p, (size_t)1 << (c + POOL_MIN_SHIFT));
+    } else {
+        b->next = pool_free[c];
+        pool_free[c] = b;
+        pool_nfree[c]++;
+    }
+}
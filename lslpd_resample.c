@@ -0,0 +1,71 @@
+/* lslpd_resample.c
+*
+* Fractional-delay interpolator used to play a stream at a rate other than
+* its own: a windowed-sinc kernel tabulated at LSLPD_RESAMPLE_PHASES offsets
+* between two samples, with the weights for any other offset interpolated
+* linearly between neighbouring phases.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <math.h>
+#include <string.h>
+
+#define HALF (LSLPD_RESAMPLE_TAPS / 2)
+#define ROWS (LSLPD_RESAMPLE_PHASES + 1)    //the last row repeats the first, one sample on
+#define ROLLOFF 0.9     //passband edge as a fraction of the output's Nyquist rate when decimating
+#define PI 3.14159265358979323846
+
+int lslpd_resampler_init(t_lslpd_resampler *r){
+    r->table = (float *)lslpd_getbytes(ROWS * LSLPD_RESAMPLE_TAPS * sizeof(float));
+    r->step = 0;
+    return r->table != NULL;
+}
+
+void lslpd_resampler_free(t_lslpd_resampler *r){
+    if (r->table)
+        lslpd_freebytes(r->table, ROWS * LSLPD_RESAMPLE_TAPS * sizeof(float));
+    r->table = NULL;
+}
+
+// a lowpass at ROLLOFF times the output Nyquist rate when decimating (step > 1);
+// when interpolating a plain sinc, whose zeros fall on the input samples so a
+// stream played at its own rate comes out unchanged. Every row sums to 1.
+void lslpd_resampler_design(t_lslpd_resampler *r, double step){
+    double cutoff = step > 1 ? ROLLOFF / step : 1;
+
+    if (!r->table || step == r->step)
+        return;
+    for (int p = 0; p < ROWS; ++p) {
+        float *row = r->table + p * LSLPD_RESAMPLE_TAPS;
+        double frac = (double)p / LSLPD_RESAMPLE_PHASES, sum = 0;
+        for (int t = 0; t < LSLPD_RESAMPLE_TAPS; ++t) {
+            // distance of tap t from the output position, in input samples
+            double d = t - (HALF - 1) - frac;
+            double arg = PI * cutoff * d;
+            double sinc = d == 0 ? 1 : sin(arg) / arg;
+            double phase = PI * (d + HALF) / HALF;    // Blackman over [-HALF, HALF]
+            double window = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2 * phase);
+            row[t] = (float)(sinc * window);
+            sum += row[t];
+        }
+        for (int t = 0; t < LSLPD_RESAMPLE_TAPS; ++t)
+            row[t] = (float)(row[t] / sum);
+    }
+    r->step = step;
+}
+
+// out = sum over the taps of weight * frame, one multiply-add across all the
+// channels of a frame at a time
+void lslpd_resampler_frame(const t_lslpd_resampler *r, float *out, const float *const *frames,
+    int nchan, double frac){
+    double x = frac * LSLPD_RESAMPLE_PHASES;
+    int p = x < LSLPD_RESAMPLE_PHASES ? (int)x : LSLPD_RESAMPLE_PHASES - 1;
+    float a = (float)(x - p);
+    const float *lo = r->table + p * LSLPD_RESAMPLE_TAPS, *hi = lo + LSLPD_RESAMPLE_TAPS;
+
+    memset(out, 0, nchan * sizeof(float));
+    for (int t = 0; t < LSLPD_RESAMPLE_TAPS; ++t)
+        lslpd_mac(out, frames[t], lo[t] + a * (hi[t] - lo[t]), nchan);
+}
@@ -0,0 +1,33 @@
+/* lslpd_resolve.c
+*
+* Non-blocking stream lookup shared by the receiving objects.
+*
+*/
+
+#include "m_pd.h"
+#include "lsl_c.h"
+#include "lslpd.h"
+#include <string.h>
+
+#define MAX_RESULTS 16          //streams considered per poll
+#define FORGET_AFTER 5.0        //seconds until a vanished stream drops out of the results
+
+lsl_continuous_resolver lslpd_resolver_new(const char *name){
+    return lsl_create_continuous_resolver_byprop("name", (char *)name, FORGET_AFTER);
+}
+
+// returns the first stream currently visible that matches, or NULL; the caller
+// owns the returned streaminfo
+lsl_streaminfo lslpd_resolver_match(lsl_continuous_resolver res, const char *type){
+    lsl_streaminfo results[MAX_RESULTS];
+    lsl_streaminfo match = NULL;
+    int n = lsl_resolver_results(res, results, MAX_RESULTS);
+
+    for (int i = 0; i < n; ++i) {
+        if (!match && (!type[0] || !strcmp(lsl_get_type(results[i]), type)))
+            match = results[i];
+        else
+            lsl_destroy_streaminfo(results[i]);
+    }
+    return match;
+}
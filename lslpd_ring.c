@@ -0,0 +1,80 @@
+/* lslpd_ring.c
+*
+* Frame ring used as jitter buffer between liblsl and the Pd objects, and as
+* the lock-free hand-off from receive threads to the Pd thread.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+
+#define LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+int lslpd_ring_init(t_lslpd_ring *r, size_t framebytes, size_t capacity){
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    r->buf = (char *)getbytes(size * framebytes);
+    if (!r->buf) {
+        r->capacity = r->mask = 0;
+        return 0;
+    }
+    r->framebytes = framebytes;
+    r->capacity = size;
+    r->mask = size - 1;
+    r->head = r->tail = 0;
+    return 1;
+}
+
+void lslpd_ring_free(t_lslpd_ring *r){
+    if (r->buf)
+        freebytes(r->buf, r->capacity * r->framebytes);
+    r->buf = 0;
+    r->capacity = r->mask = 0;
+    r->head = r->tail = 0;
+}
+
+// consumer side: drop everything currently queued
+void lslpd_ring_clear(t_lslpd_ring *r){
+    STORE(&r->tail, LOAD(&r->head));
+}
+
+size_t lslpd_ring_count(const t_lslpd_ring *r){
+    return LOAD(&r->head) - LOAD(&r->tail);
+}
+
+size_t lslpd_ring_space(const t_lslpd_ring *r){
+    return r->capacity - lslpd_ring_count(r);
+}
+
+// contiguous free region starting at the write position (may be shorter than
+// the total free space when it wraps around the end of the storage)
+void *lslpd_ring_writeptr(t_lslpd_ring *r, size_t *frames){
+    size_t pos = r->head & r->mask;     // only the producer writes head
+    size_t space = lslpd_ring_space(r);
+    size_t contiguous = r->capacity - pos;
+    *frames = space < contiguous ? space : contiguous;
+    return r->buf + pos * r->framebytes;
+}
+
+void lslpd_ring_commit(t_lslpd_ring *r, size_t frames){
+    STORE(&r->head, r->head + frames);
+}
+
+// contiguous filled region starting at the read position
+void *lslpd_ring_readptr(t_lslpd_ring *r, size_t *frames){
+    size_t pos = r->tail & r->mask;     // only the consumer writes tail
+    size_t count = lslpd_ring_count(r);
+    size_t contiguous = r->capacity - pos;
+    *frames = count < contiguous ? count : contiguous;
+    return r->buf + pos * r->framebytes;
+}
+
+void lslpd_ring_consume(t_lslpd_ring *r, size_t frames){
+    STORE(&r->tail, r->tail + frames);
+}
+
+void *lslpd_ring_peek(const t_lslpd_ring *r, size_t offset){
+    return r->buf + ((r->tail + offset) & r->mask) * r->framebytes;
+}
@@ -0,0 +1,425 @@
+/* lslpd_simd.c
+*
+* Vector kernels for the per-value work on wide streams: converting int16,
+* int32 and double samples to float, filling and reading t_atom lists, and
+* (de)interleaving chunks against Pd's per-channel signal vectors, the
+* weighted sums of frames the resampler is made of, and the biquad cascades of
+* the receive filters.
+*
+* Every kernel has a plain C version. On x86 with GCC or clang there are also
+* SSE2 and AVX2 versions, compiled with target attributes so the rest of the
+* library keeps the default instruction set, and the best one the CPU supports
+* is picked the first time a kernel is used.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <stddef.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && PD_FLOATSIZE == 32
+#define LSLPD_X86 1
+#include <immintrin.h>
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+/* ---- plain C ---- */
+
+static void s16_to_float_c(float *dst, const short *src, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (float)src[i];
+}
+
+static void s32_to_float_c(float *dst, const int *src, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (float)src[i];
+}
+
+static void f64_to_float_c(float *dst, const double *src, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (float)src[i];
+}
+
+static void float_to_atoms_c(t_atom *dst, const float *src, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        SETFLOAT(dst + i, src[i]);
+}
+
+static void atoms_to_float_c(float *dst, const t_atom *src, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = atom_getfloat((t_atom *)src + i);
+}
+
+static void deinterleave_c(t_sample **out, size_t offset, const float *src, int nchan, size_t frames){
+    for (int k = 0; k < nchan; ++k) {
+        t_sample *o = out[k] + offset;
+        const float *in = src + k;
+        for (size_t i = 0; i < frames; ++i, in += nchan)
+            o[i] = *in;
+    }
+}
+
+static void interleave_c(float *dst, t_sample **in, int nchan, size_t frames){
+    for (int k = 0; k < nchan; ++k) {
+        const t_sample *s = in[k];
+        float *o = dst + k;
+        for (size_t i = 0; i < frames; ++i, o += nchan)
+            *o = s[i];
+    }
+}
+
+static void mac_c(float *acc, const float *src, float w, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        acc[i] += w * src[i];
+}
+
+// channels k0 to nchan-1 of one frame through every section (transposed
+// direct form II); also the tail of the vector versions
+static void biquads_frame_c(float *frame, int k0, int nchan, const float *coefs, int nsections,
+    float *state){
+    for (int s = 0; s < nsections; ++s) {
+        const float *c = coefs + 5 * s;
+        float *z1 = state + 2 * s * nchan, *z2 = z1 + nchan;
+        for (int k = k0; k < nchan; ++k) {
+            float x = frame[k], y = c[0] * x + z1[k];
+            z1[k] = c[1] * x - c[3] * y + z2[k];
+            z2[k] = c[2] * x - c[4] * y;
+            frame[k] = y;
+        }
+    }
+}
+
+static void biquads_c(float *frames, size_t n, int nchan, const float *coefs, int nsections,
+    float *state){
+    for (size_t i = 0; i < n; ++i, frames += nchan)
+        biquads_frame_c(frames, 0, nchan, coefs, nsections, state);
+}
+
+#ifdef LSLPD_X86
+
+/* ---- SSE2 ---- */
+
+SSE2 static void s16_to_float_sse2(float *dst, const short *src, size_t n){
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        // put each short in the top half of a 32-bit lane, then shift it down with sign
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(hi));
+    }
+    s16_to_float_c(dst + i, src + i, n - i);
+}
+
+SSE2 static void s32_to_float_sse2(float *dst, const int *src, size_t n){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+    s32_to_float_c(dst + i, src + i, n - i);
+}
+
+SSE2 static void f64_to_float_sse2(float *dst, const double *src, size_t n){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+    }
+    f64_to_float_c(dst + i, src + i, n - i);
+}
+
+/*
+* With 32-bit floats on a 64-bit build an atom is 16 bytes: the type, 4 bytes
+* of padding, the float and 4 more bytes of padding, i.e. exactly one SSE
+* register. The atom kernels are only used when that layout holds.
+*/
+#define ATOM_IS_VECTOR (sizeof(t_atom) == 4 * sizeof(float) && offsetof(t_atom, a_w) == 2 * sizeof(float))
+
+SSE2 static void float_to_atoms_sse2(t_atom *dst, const float *src, size_t n){
+    const __m128 type = _mm_castsi128_ps(_mm_set_epi32(0, A_FLOAT, 0, A_FLOAT));
+    const __m128 zero = _mm_setzero_ps();
+    float *out = (float *)dst;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, out += 16) {
+        __m128 v = _mm_loadu_ps(src + i);
+        __m128 lo = _mm_unpacklo_ps(v, zero);    // f0 0 f1 0
+        __m128 hi = _mm_unpackhi_ps(v, zero);    // f2 0 f3 0
+        _mm_storeu_ps(out, _mm_movelh_ps(type, lo));
+        _mm_storeu_ps(out + 4, _mm_movehl_ps(lo, type));
+        _mm_storeu_ps(out + 8, _mm_movelh_ps(type, hi));
+        _mm_storeu_ps(out + 12, _mm_movehl_ps(hi, type));
+    }
+    float_to_atoms_c(dst + i, src + i, n - i);
+}
+
+SSE2 static void atoms_to_float_sse2(float *dst, const t_atom *src, size_t n){
+    const __m128i isfloat = _mm_set1_epi32(A_FLOAT);
+    const float *in = (const float *)src;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, in += 16) {
+        __m128 a0 = _mm_loadu_ps(in), a1 = _mm_loadu_ps(in + 4);
+        __m128 a2 = _mm_loadu_ps(in + 8), a3 = _mm_loadu_ps(in + 12);
+        __m128 t01 = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));   // type0 f0 type1 f1
+        __m128 t23 = _mm_shuffle_ps(a2, a3, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 types = _mm_shuffle_ps(t01, t23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 values = _mm_shuffle_ps(t01, t23, _MM_SHUFFLE(3, 1, 3, 1));
+        // like atom_getfloat(), anything that isn't a float reads as 0
+        __m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_castps_si128(types), isfloat));
+        _mm_storeu_ps(dst + i, _mm_and_ps(values, mask));
+    }
+    atoms_to_float_c(dst + i, src + i, n - i);
+}
+
+SSE2 static void deinterleave_sse2(t_sample **out, size_t offset, const float *src, int nchan, size_t frames){
+    size_t i = 0;
+    if (nchan != 2) {
+        deinterleave_c(out, offset, src, nchan, frames);
+        return;
+    }
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(src + 2 * i), b = _mm_loadu_ps(src + 2 * i + 4);
+        _mm_storeu_ps(out[0] + offset + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(out[1] + offset + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleave_c(out, offset + i, src + 2 * i, nchan, frames - i);
+}
+
+SSE2 static void interleave_sse2(float *dst, t_sample **in, int nchan, size_t frames){
+    size_t i = 0;
+    if (nchan != 2) {
+        interleave_c(dst, in, nchan, frames);
+        return;
+    }
+    for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(in[0] + i), r = _mm_loadu_ps(in[1] + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    for (; i < frames; ++i) {
+        dst[2 * i] = in[0][i];
+        dst[2 * i + 1] = in[1][i];
+    }
+}
+
+SSE2 static void mac_sse2(float *acc, const float *src, float w, size_t n){
+    const __m128 weight = _mm_set1_ps(w);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(weight, _mm_loadu_ps(src + i))));
+    mac_c(acc + i, src + i, w, n - i);
+}
+
+// 4 channels at a time, each block kept in a register through all the sections
+SSE2 static void biquads_sse2(float *frames, size_t n, int nchan, const float *coefs, int nsections,
+    float *state){
+    for (size_t i = 0; i < n; ++i, frames += nchan) {
+        int k = 0;
+        for (; k + 4 <= nchan; k += 4) {
+            __m128 x = _mm_loadu_ps(frames + k);
+            for (int s = 0; s < nsections; ++s) {
+                const float *c = coefs + 5 * s;
+                float *z1 = state + 2 * s * nchan + k, *z2 = z1 + nchan;
+                __m128 y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c[0]), x), _mm_loadu_ps(z1));
+                _mm_storeu_ps(z1, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c[1]), x),
+                    _mm_mul_ps(_mm_set1_ps(c[3]), y)), _mm_loadu_ps(z2)));
+                _mm_storeu_ps(z2, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c[2]), x),
+                    _mm_mul_ps(_mm_set1_ps(c[4]), y)));
+                x = y;
+            }
+            _mm_storeu_ps(frames + k, x);
+        }
+        biquads_frame_c(frames, k, nchan, coefs, nsections, state);
+    }
+}
+
+/* ---- AVX2 ---- */
+
+AVX2 static void s16_to_float_avx2(float *dst, const short *src, size_t n){
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(v));
+    }
+    s16_to_float_c(dst + i, src + i, n - i);
+}
+
+AVX2 static void s32_to_float_avx2(float *dst, const int *src, size_t n){
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(src + i))));
+    s32_to_float_c(dst + i, src + i, n - i);
+}
+
+AVX2 static void f64_to_float_avx2(float *dst, const double *src, size_t n){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+    f64_to_float_c(dst + i, src + i, n - i);
+}
+
+// any channel count: gather 8 frames of one channel per instruction
+AVX2 static void deinterleave_avx2(t_sample **out, size_t offset, const float *src, int nchan, size_t frames){
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(nchan));
+    size_t i = 0;
+    if (nchan <= 2) {
+        deinterleave_sse2(out, offset, src, nchan, frames);
+        return;
+    }
+    for (; i + 8 <= frames; i += 8) {
+        const float *frame = src + i * nchan;
+        for (int k = 0; k < nchan; ++k)
+            _mm256_storeu_ps(out[k] + offset + i, _mm256_i32gather_ps(frame + k, index, 4));
+    }
+    deinterleave_c(out, offset + i, src + i * nchan, nchan, frames - i);
+}
+
+AVX2 static void mac_avx2(float *acc, const float *src, float w, size_t n){
+    const __m256 weight = _mm256_set1_ps(w);
+    size_t i = 0;
+    if (n < 8) {
+        mac_sse2(acc, src, w, n);
+        return;
+    }
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(weight, _mm256_loadu_ps(src + i))));
+    mac_sse2(acc + i, src + i, w, n - i);
+}
+
+AVX2 static void biquads_avx2(float *frames, size_t n, int nchan, const float *coefs, int nsections,
+    float *state){
+    if (nchan < 8) {
+        biquads_sse2(frames, n, nchan, coefs, nsections, state);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i, frames += nchan) {
+        int k = 0;
+        for (; k + 8 <= nchan; k += 8) {
+            __m256 x = _mm256_loadu_ps(frames + k);
+            for (int s = 0; s < nsections; ++s) {
+                const float *c = coefs + 5 * s;
+                float *z1 = state + 2 * s * nchan + k, *z2 = z1 + nchan;
+                __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(c[0]), x), _mm256_loadu_ps(z1));
+                _mm256_storeu_ps(z1, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(c[1]), x),
+                    _mm256_mul_ps(_mm256_set1_ps(c[3]), y)), _mm256_loadu_ps(z2)));
+                _mm256_storeu_ps(z2, _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(c[2]), x),
+                    _mm256_mul_ps(_mm256_set1_ps(c[4]), y)));
+                x = y;
+            }
+            _mm256_storeu_ps(frames + k, x);
+        }
+        biquads_frame_c(frames, k, nchan, coefs, nsections, state);
+    }
+}
+
+#endif /* LSLPD_X86 */
+
+/* ---- dispatch ---- */
+
+static void (*s16_to_float)(float *, const short *, size_t);
+static void (*s32_to_float)(float *, const int *, size_t);
+static void (*f64_to_float)(float *, const double *, size_t);
+static void (*float_to_atoms)(t_atom *, const float *, size_t);
+static void (*atoms_to_float)(float *, const t_atom *, size_t);
+static void (*deinterleave)(t_sample **, size_t, const float *, int, size_t);
+static void (*interleave)(float *, t_sample **, int, size_t);
+static void (*mac)(float *, const float *, float, size_t);
+static void (*biquads)(float *, size_t, int, const float *, int, float *);
+static const char *simd_name;
+
+// pick the kernels once; every thread picks the same ones, so a race is
+// harmless as long as simd_name is published after the pointers
+static void simd_init(void){
+    const char *name = "scalar";
+
+    s16_to_float = s16_to_float_c;
+    s32_to_float = s32_to_float_c;
+    f64_to_float = f64_to_float_c;
+    float_to_atoms = float_to_atoms_c;
+    atoms_to_float = atoms_to_float_c;
+    deinterleave = deinterleave_c;
+    interleave = interleave_c;
+    mac = mac_c;
+    biquads = biquads_c;
+#ifdef LSLPD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        s16_to_float = s16_to_float_sse2;
+        s32_to_float = s32_to_float_sse2;
+        f64_to_float = f64_to_float_sse2;
+        if (ATOM_IS_VECTOR) {
+            float_to_atoms = float_to_atoms_sse2;
+            atoms_to_float = atoms_to_float_sse2;
+        }
+        deinterleave = deinterleave_sse2;
+        interleave = interleave_sse2;
+        mac = mac_sse2;
+        biquads = biquads_sse2;
+        name = "sse2";
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        s16_to_float = s16_to_float_avx2;
+        s32_to_float = s32_to_float_avx2;
+        f64_to_float = f64_to_float_avx2;
+        deinterleave = deinterleave_avx2;
+        mac = mac_avx2;
+        biquads = biquads_avx2;
+        name = "avx2";
+    }
+#endif
+    __atomic_store_n(&simd_name, name, __ATOMIC_RELEASE);
+}
+
+#define ENSURE_INIT() do { if (!__atomic_load_n(&simd_name, __ATOMIC_ACQUIRE)) simd_init(); } while (0)
+
+const char *lslpd_simd_name(void){
+    ENSURE_INIT();
+    return simd_name;
+}
+
+void lslpd_s16_to_float(float *dst, const short *src, size_t n){
+    ENSURE_INIT();
+    s16_to_float(dst, src, n);
+}
+
+void lslpd_s32_to_float(float *dst, const int *src, size_t n){
+    ENSURE_INIT();
+    s32_to_float(dst, src, n);
+}
+
+void lslpd_f64_to_float(float *dst, const double *src, size_t n){
+    ENSURE_INIT();
+    f64_to_float(dst, src, n);
+}
+
+void lslpd_float_to_atoms(t_atom *dst, const float *src, size_t n){
+    ENSURE_INIT();
+    float_to_atoms(dst, src, n);
+}
+
+void lslpd_atoms_to_float(float *dst, const t_atom *src, size_t n){
+    ENSURE_INIT();
+    atoms_to_float(dst, src, n);
+}
+
+void lslpd_deinterleave(t_sample **out, size_t offset, const float *src, int nchan, size_t frames){
+    ENSURE_INIT();
+    deinterleave(out, offset, src, nchan, frames);
+}
+
+void lslpd_interleave(float *dst, t_sample **in, int nchan, size_t frames){
+    ENSURE_INIT();
+    interleave(dst, in, nchan, frames);
+}
+
+void lslpd_mac(float *acc, const float *src, float w, size_t n){
+    ENSURE_INIT();
+    mac(acc, src, w, n);
+}
+
+void lslpd_biquads(float *frames, size_t n, int nchan, const float *coefs, int nsections, float *state){
+    ENSURE_INIT();
+    biquads(frames, n, nchan, coefs, nsections, state);
+}
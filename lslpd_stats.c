@@ -0,0 +1,69 @@
+/* lslpd_stats.c
+*
+* Runtime statistics reported by the objects' 'stats' method and stats outlet.
+*
+*/
+
+#include "m_pd.h"
+#include "lslpd.h"
+#include <string.h>
+
+#define NUMBER_LENGTH 32      //room for one value on the console
+
+void lslpd_timing_clear(t_lslpd_timing *t){
+    int i;
+    t->count = 0;
+    t->sum = t->min = t->max = 0;
+    for (i = 0; i < LSLPD_TIMING_BUCKETS; ++i)
+        t->hist[i] = 0;
+}
+
+void lslpd_timing_add(t_lslpd_timing *t, double seconds){
+    double us = seconds * 1e6;
+    int bucket = 0;
+
+    if (!t->count || seconds < t->min)
+        t->min = seconds;
+    if (seconds > t->max)
+        t->max = seconds;
+    t->sum += seconds;
+    t->count++;
+    while (us >= 1 && bucket < LSLPD_TIMING_BUCKETS - 1) {
+        us *= 0.5;
+        bucket++;
+    }
+    t->hist[bucket]++;
+}
+
+// "<sel> <values...>" out of the outlet, or on the console if there is none
+void lslpd_stats_out(t_outlet *outlet, const char *owner, const char *sel, int n, t_atom *values){
+    if (outlet) {
+        outlet_anything(outlet, gensym(sel), n, values);
+        return;
+    }
+    char line[MAXPDSTRING], *pos = line;
+    int i;
+
+    *line = 0;
+    for (i = 0; i < n && pos + NUMBER_LENGTH + 1 < line + MAXPDSTRING; ++i) {
+        *pos++ = ' ';
+        atom_string(values + i, pos, NUMBER_LENGTH);
+        pos += strlen(pos);
+    }
+    post("%s: %s%s", owner, sel, line);
+}
+
+// "<sel> <min> <mean> <max>" in microseconds, then "<histsel> <bucket counts...>"
+void lslpd_timing_out(const t_lslpd_timing *t, t_outlet *outlet, const char *owner,
+    const char *sel, const char *histsel){
+    t_atom av[LSLPD_TIMING_BUCKETS];
+    int i;
+
+    SETFLOAT(av, t->min * 1e6);
+    SETFLOAT(av + 1, t->count ? t->sum / t->count * 1e6 : 0);
+    SETFLOAT(av + 2, t->max * 1e6);
+    lslpd_stats_out(outlet, owner, sel, 3, av);
+    for (i = 0; i < LSLPD_TIMING_BUCKETS; ++i)
+        SETFLOAT(av + i, t->hist[i]);
+    lslpd_stats_out(outlet, owner, histsel, LSLPD_TIMING_BUCKETS, av);
+}
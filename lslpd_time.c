@@ -0,0 +1,59 @@
+/* lslpd_time.c
+*
+* Conversion between Pd logical time and LSL time stamps.
+*
+*/
+
+#include "m_pd.h"
+#include "lsl_c.h"
+#include "lslpd.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+void lslpd_timebase_sync(t_lslpd_timebase *tb){
+    tb->logical = clock_getlogicaltime();
+    tb->lsl = lsl_local_clock();
+}
+
+// LSL time corresponding to the current logical time (in seconds)
+double lslpd_timebase_now(const t_lslpd_timebase *tb){
+    return tb->lsl + clock_gettimesince(tb->logical) * 0.001;
+}
+
+// as lslpd_timebase_now(), re-anchored when due so the two clocks can't drift
+// apart, and held back rather than going backwards across a re-anchoring
+double lslpd_timebase_stamp(t_lslpd_timebase *tb){
+    double now;
+
+    if (clock_gettimesince(tb->logical) >= LSLPD_RESYNC_INTERVAL_MS)
+        lslpd_timebase_sync(tb);
+    now = lslpd_timebase_now(tb);
+    if (now < tb->last)
+        now = tb->last;
+    return tb->last = now;
+}
+
+int lslpd_stamp_to_atoms(t_atom *av, double stamp){
+#if PD_FLOATSIZE == 64
+    SETFLOAT(av, stamp);
+#else
+    t_float hi = (t_float)stamp;
+    SETFLOAT(av, hi);
+    SETFLOAT(av + 1, (t_float)(stamp - hi));
+#endif
+    return LSLPD_STAMP_ATOMS;
+}
+
+void lslpd_sleep(double seconds){
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1000));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
@@ -0,0 +1,666 @@
+/*
+* lslplay object for Pure Data.
+*
+* Replays a stream recorded to an XDF file (e.g. by [lslrecord]) into an LSL
+* outlet, in real time or faster. 'open <file>' reads the stream header and
+* creates the outlet the way [lslsend] does, with the recorded name, type,
+* channel count, rate and format. A player thread then reads the samples
+* chunks ahead of time and pushes them with lsl_push_chunk_*tn as they come
+* due, each stamped with its recorded time stamp moved to the present (and
+* scaled by the speed factor). Pd only sends play/stop/speed/seek messages.
+*
+* The left outlet reports the position in seconds from the start of the
+* recording, the right one the state: "paused", "playing", "end" or "error".
+*
+*/
+
+#include "m_pd.h"      //pd header file
+#include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+
+#define MAX_ARG_LENGTH 256
+#define READ_BUFFER_BYTES (1 << 20) //stdio buffer of the file, so the disk sees large reads
+#define WORKER_SLEEP 0.001      //seconds the player thread sleeps while nothing is due
+#define REPORT_INTERVAL_MS 100  //position output while a file is open
+#define MAX_HEADER_BYTES (1 << 20)  //longest stream header accepted
+
+/* XDF chunk tags */
+enum { XDF_STREAMHEADER = 2, XDF_SAMPLES = 3 };
+
+/* states reported on the status outlet */
+enum { STATE_PAUSED, STATE_PLAYING, STATE_END, STATE_ERROR };
+static const char *state_names[] = { "paused", "playing", "end", "error" };
+
+static t_class *lslplay_class;
+
+typedef struct _lslplay{
+    t_object x_obj;
+
+    /* from the arguments */
+    char name[MAX_ARG_LENGTH];  /* stream name to publish, empty = recorded name */
+    char type[MAX_ARG_LENGTH];  /* stream type to publish, empty = recorded type */
+    int stream_id;              /* XDF stream to play, 0 = the first one in the file */
+    int max_buffer;             /* liblsl buffer in seconds */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = per push */
+    t_canvas *canvas;           /* relative file names are relative to the patch */
+
+    /* the open file, set up by 'open' */
+    FILE *file;
+    char *file_buffer;          /* READ_BUFFER_BYTES for setvbuf */
+    long long data_start;       /* offset of the first chunk after the stream header */
+    int id;                     /* XDF id of the stream being played */
+    double t0;                  /* first recorded time stamp, position 0 */
+    double srate;
+    int nchan;
+    const t_lslpd_format *format;
+    lsl_streaminfo info;
+    lsl_outlet outlet;
+
+    /* requests from Pd, taken by the player thread */
+    pthread_mutex_t lock;
+    int req_play;               /* 1 = play, 0 = pause */
+    double req_speed;
+    int req_seek;               /* a seek is pending */
+    double req_position;        /* seconds from t0 */
+    int req_quit;
+
+    /* player thread; the buffers are its own (malloc), sized as chunks come in */
+    pthread_t worker;
+    int worker_running;
+    int state;                  /* written by the thread */
+    double position;            /* last sample pushed, in seconds from t0 */
+    char *chunk;                /* one chunk's content as read */
+    size_t chunk_size;
+    size_t frames;              /* samples the buffers below hold */
+    void *values;               /* decoded samples in the format's C type */
+    double *stamps;             /* recorded time stamps */
+    double *due;                /* the same moved to the present: push times and stamps */
+    char *text;                 /* string streams: the values, terminated */
+    size_t text_size;
+    double last_stamp;          /* samples without a time stamp follow the one before */
+
+    t_clock *clock;
+    int reported_state;
+    double reported_position;
+    t_outlet *out_position, *out_status;
+} t_lslplay;
+
+
+void *lslplay_new(t_symbol *s, long argc, t_atom *argv);
+void lslplay_free(t_lslplay *x);
+void lslplay_open(t_lslplay *x, t_symbol *file);
+void lslplay_play(t_lslplay *x);
+void lslplay_stop(t_lslplay *x);
+void lslplay_speed(t_lslplay *x, t_floatarg f);
+void lslplay_seek(t_lslplay *x, t_floatarg f);
+static void lslplay_close(t_lslplay *x);
+static void lslplay_tick(t_lslplay *x);
+static void *lslplay_worker(void *arg);
+
+
+void *lslplay_new(t_symbol *s, long argc, t_atom *argv){
+    t_lslplay *x = (t_lslplay *)pd_new(lslplay_class);
+
+    x->max_buffer = LSLPD_MAX_BUFFER;
+    x->req_speed = 1;
+
+    /* Optional file, then flags (-name <stream name>, -type <stream type>, -stream <id>,
+       -speed <factor>, -maxbuffer <seconds>, -chunk <samples>) */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-name") && i + 1 < argc) {
+            strncpy(x->name, atom_getsymbol(&argv[++i])->s_name, MAX_ARG_LENGTH - 1);
+        } else if (!strcmp(flag, "-type") && i + 1 < argc) {
+            strncpy(x->type, atom_getsymbol(&argv[++i])->s_name, MAX_ARG_LENGTH - 1);
+        } else if (!strcmp(flag, "-stream") && i + 1 < argc) {
+            x->stream_id = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-speed") && i + 1 < argc) {
+            x->req_speed = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    if (x->req_speed <= 0) {
+        post("Warning: the speed must be positive; playing in real time");
+        x->req_speed = 1;
+    }
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+    if (x->max_chunk < 0)
+        x->max_chunk = 0;
+
+    pthread_mutex_init(&x->lock, NULL);
+    x->canvas = canvas_getcurrent();
+    x->clock = clock_new(x, (t_method)lslplay_tick);
+    x->out_position = outlet_new(&x->x_obj, &s_float);  /* Left: position in seconds */
+    x->out_status = outlet_new(&x->x_obj, &s_symbol);   /* Right: state */
+    x->reported_state = -1;
+    if (npos && argv[0].a_type == A_SYMBOL)
+        lslplay_open(x, atom_getsymbol(&argv[0]));
+    return (void *)x;
+}
+
+void lslplay_setup(void) {
+  lslplay_class = class_new(gensym("lslplay"),
+                                (t_newmethod)lslplay_new,
+                                (t_method)lslplay_free,
+                                sizeof(t_lslplay),
+                                CLASS_DEFAULT,
+                                A_GIMME,
+                                0);
+
+  class_addmethod(lslplay_class, (t_method)lslplay_open, gensym("open"), A_SYMBOL, 0);
+  class_addmethod(lslplay_class, (t_method)lslplay_play, gensym("play"), 0);
+  class_addmethod(lslplay_class, (t_method)lslplay_stop, gensym("stop"), 0);
+  class_addmethod(lslplay_class, (t_method)lslplay_speed, gensym("speed"), A_FLOAT, 0);
+  class_addmethod(lslplay_class, (t_method)lslplay_seek, gensym("seek"), A_FLOAT, 0);
+}
+
+
+/* ==== reading XDF ==== */
+
+static unsigned long long lslplay_get(const char *p, int bytes){
+    unsigned long long value = 0;
+    for (int i = bytes - 1; i >= 0; --i)
+        value = (value << 8) | (unsigned char)p[i];
+    return value;
+}
+
+// the chunk header at the current file position: content length and tag;
+// returns 0 at the end of the file
+static int lslplay_chunk_header(FILE *f, unsigned long long *len, int *tag){
+    char buf[8];
+    int nbytes = fgetc(f);
+
+    if ((nbytes != 1 && nbytes != 4 && nbytes != 8) || fread(buf, 1, nbytes, f) != (size_t)nbytes)
+        return 0;
+    *len = lslplay_get(buf, nbytes);
+    if (*len < 2 || fread(buf, 1, 2, f) != 2)
+        return 0;
+    *tag = (int)lslplay_get(buf, 2);
+    *len -= 2;
+    return 1;
+}
+
+// the first time stamp of a samples chunk, after its content length and tag
+// have been read; returns 0 if the chunk is empty or its first sample has none
+static int lslplay_peek_stamp(FILE *f, int *id, double *stamp){
+    char buf[12];
+    int nbytes;
+
+    if (fread(buf, 1, 5, f) != 5)
+        return 0;
+    *id = (int)lslplay_get(buf, 4);
+    nbytes = (unsigned char)buf[4];
+    if (nbytes > 8 || fread(buf, 1, nbytes + 1, f) != (size_t)nbytes + 1 || !lslplay_get(buf, nbytes))
+        return 0;
+    if (buf[nbytes] != 8 || fread(stamp, 1, 8, f) != 8)
+        return 0;
+    return 1;
+}
+
+// the text of an element of the stream header, e.g. <channel_count>
+static int lslplay_xml(const char *xml, const char *tag, char *value, size_t size){
+    char open[64];
+    const char *start, *end;
+
+    snprintf(open, sizeof(open), "<%s>", tag);
+    if (!(start = strstr(xml, open)))
+        return 0;
+    start += strlen(open);
+    if (!(end = strchr(start, '<')) || (size_t)(end - start) >= size)
+        return 0;
+    memcpy(value, start, end - start);
+    value[end - start] = 0;
+    return 1;
+}
+
+// pick up the stream from its header and create the outlet for it
+static int lslplay_outlet(t_lslplay *x, const char *xml){
+    char name[MAX_ARG_LENGTH], type[MAX_ARG_LENGTH], value[MAX_ARG_LENGTH];
+
+    if (!lslplay_xml(xml, "channel_format", value, sizeof(value)) || !(x->format = lslpd_format_byname(value))) {
+        pd_error(x, "lslplay: the stream has an unsupported channel format");
+        return 0;
+    }
+    if (!lslplay_xml(xml, "channel_count", value, sizeof(value)) || (x->nchan = atoi(value)) < 1) {
+        pd_error(x, "lslplay: the stream has no channels");
+        return 0;
+    }
+    x->srate = lslplay_xml(xml, "nominal_srate", value, sizeof(value)) ? atof(value) : 0;
+    if (!lslplay_xml(xml, "name", name, sizeof(name)))
+        strcpy(name, "pd_play");
+    if (!lslplay_xml(xml, "type", type, sizeof(type)))
+        *type = 0;
+    if (*x->name)
+        strcpy(name, x->name);
+    if (*x->type)
+        strcpy(type, x->type);
+
+    post("Creating a stream named '%s' (%d channels of %s).", name, x->nchan, x->format->name);
+    x->info = lsl_create_streaminfo(name, type, x->nchan, x->srate, x->format->format, "");
+    x->outlet = x->info ? lsl_create_outlet(x->info, x->max_chunk, x->max_buffer) : NULL;
+    if (!x->outlet) {
+        pd_error(x, "lslplay: problem creating the stream");
+        return 0;
+    }
+    return 1;
+}
+
+// read the headers up to the stream's first samples chunk; the samples are
+// left to the player thread
+static int lslplay_read_header(t_lslplay *x){
+    unsigned long long len;
+    int tag, id;
+    long long next;
+    char magic[4];
+
+    if (fread(magic, 1, 4, x->file) != 4 || memcmp(magic, "XDF:", 4)) {
+        pd_error(x, "lslplay: not an XDF file");
+        return 0;
+    }
+    while (lslplay_chunk_header(x->file, &len, &tag)) {
+        next = ftello(x->file) + (long long)len;
+        if (tag == XDF_STREAMHEADER && !x->outlet && len > 4 && len < MAX_HEADER_BYTES) {
+            char *xml = (char *)getbytes(len + 1);
+            int ok = fread(xml, 1, len, x->file) == len;
+            id = (int)lslplay_get(xml, 4);
+            if (ok && (!x->stream_id || id == x->stream_id)) {
+                ok = lslplay_outlet(x, xml + 4);
+                x->id = id;
+                x->data_start = next;
+            }
+            freebytes(xml, len + 1);
+            if (!ok)
+                return 0;
+        } else if (tag == XDF_SAMPLES && x->outlet && lslplay_peek_stamp(x->file, &id, &x->t0) && id == x->id) {
+            return 1;
+        }
+        if (fseeko(x->file, next, SEEK_SET))
+            break;
+    }
+    if (!x->outlet)
+        pd_error(x, "lslplay: stream %d is not in the file", x->stream_id);
+    else
+        pd_error(x, "lslplay: the stream has no samples");
+    return 0;
+}
+
+
+/* ==== player thread ==== */
+
+static int lslplay_grow(t_lslplay *x, size_t frames, size_t text){
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+
+    if (frames > x->frames) {
+        void *values = realloc(x->values, frames * samplebytes);
+        double *stamps = realloc(x->stamps, frames * sizeof(double));
+        double *due = realloc(x->due, frames * sizeof(double));
+        if (values)
+            x->values = values;
+        if (stamps)
+            x->stamps = stamps;
+        if (due)
+            x->due = due;
+        if (!values || !stamps || !due)
+            return 0;
+        x->frames = frames;
+    }
+    if (text > x->text_size) {
+        char *t = realloc(x->text, text);
+        if (!t)
+            return 0;
+        x->text = t;
+        x->text_size = text;
+    }
+    return 1;
+}
+
+// decode the samples chunk in x->chunk (len bytes); returns the number of
+// samples, or -1 if the chunk is damaged
+static long lslplay_decode(t_lslplay *x, size_t len){
+    const char *p = x->chunk + 4, *end = x->chunk + len;
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+    int string = x->format->format == cft_string;
+    unsigned long long n;
+    double stamp = x->last_stamp;
+    char *text;
+    int nbytes;
+
+    if (p >= end || (nbytes = (unsigned char)*p++) > 8 || p + nbytes > end)
+        return -1;
+    n = lslplay_get(p, nbytes);
+    p += nbytes;
+    // every sample takes at least a byte, and a string value at most the chunk
+    if (n > len || !lslplay_grow(x, n, string ? len + n * x->nchan : 0))
+        return -1;
+    text = x->text;
+    for (unsigned long long i = 0; i < n; ++i) {
+        if (p >= end)
+            return -1;
+        if (*p == 8 && p + 9 <= end) {
+            memcpy(&stamp, p + 1, 8);
+            p += 9;
+        } else if (*p == 0) {
+            // no stamp: the previous one plus a sample period
+            stamp += x->srate > 0 ? 1.0 / x->srate : 0;
+            p++;
+        } else {
+            return -1;
+        }
+        x->stamps[i] = stamp;
+        if (!string) {
+            if (p + samplebytes > end)
+                return -1;
+            memcpy((char *)x->values + i * samplebytes, p, samplebytes);
+            p += samplebytes;
+            continue;
+        }
+        for (int k = 0; k < x->nchan; ++k) {
+            unsigned long long slen;
+            if (p >= end || (nbytes = (unsigned char)*p++) > 8 || p + nbytes > end)
+                return -1;
+            slen = lslplay_get(p, nbytes);
+            p += nbytes;
+            if (slen > (unsigned long long)(end - p))
+                return -1;
+            ((char **)x->values)[i * x->nchan + k] = text;
+            memcpy(text, p, slen);
+            text[slen] = 0;
+            text += slen + 1;
+            p += slen;
+        }
+    }
+    x->last_stamp = stamp;
+    return (long)n;
+}
+
+// read up to the next samples chunk of the stream and decode it; returns the
+// number of samples, 0 at the end of the file or -1 if it is damaged
+static long lslplay_next(t_lslplay *x){
+    unsigned long long len;
+    int tag;
+
+    while (lslplay_chunk_header(x->file, &len, &tag)) {
+        if (tag != XDF_SAMPLES || len < 4) {
+            if (fseeko(x->file, (long long)len, SEEK_CUR))
+                return 0;
+            continue;
+        }
+        if (len > x->chunk_size) {
+            char *chunk = realloc(x->chunk, len);
+            if (!chunk)
+                return -1;
+            x->chunk = chunk;
+            x->chunk_size = len;
+        }
+        if (fread(x->chunk, 1, len, x->file) != len)
+            return 0;
+        if ((int)lslplay_get(x->chunk, 4) == x->id)
+            return lslplay_decode(x, len);
+    }
+    return 0;
+}
+
+// position the file on the chunk that holds 'stamp': chunks are skipped by
+// their first time stamp, and only the last one starting before it is read
+static long lslplay_find(t_lslplay *x, double stamp){
+    long long offset, found = x->data_start;
+    unsigned long long len;
+    double first;
+    int tag, id;
+
+    fseeko(x->file, x->data_start, SEEK_SET);
+    while ((offset = ftello(x->file)) >= 0 && lslplay_chunk_header(x->file, &len, &tag)) {
+        long long next = ftello(x->file) + (long long)len;
+        if (tag == XDF_SAMPLES && lslplay_peek_stamp(x->file, &id, &first) && id == x->id) {
+            if (first > stamp)
+                break;
+            found = offset;
+        }
+        if (fseeko(x->file, next, SEEK_SET))
+            break;
+    }
+    fseeko(x->file, found, SEEK_SET);
+    return lslplay_next(x);
+}
+
+static void lslplay_setstate(t_lslplay *x, int state){
+    __atomic_store_n(&x->state, state, __ATOMIC_RELAXED);
+}
+
+// at the end (or on an error) playback pauses until the next 'play'
+static void lslplay_ended(t_lslplay *x, int state){
+    pthread_mutex_lock(&x->lock);
+    x->req_play = 0;
+    pthread_mutex_unlock(&x->lock);
+    lslplay_setstate(x, state);
+}
+
+static void *lslplay_worker(void *arg){
+    t_lslplay *x = (t_lslplay *)arg;
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+    long n = 0, i = 0;
+    int playing = 0, seek = 1;
+    double speed = 1, position = 0;
+    double anchor_local = 0, anchor_file = x->t0;   // due(t) = anchor_local + (t - anchor_file) / speed
+
+    for (;;) {
+        int play, quit;
+        double req_speed;
+
+        pthread_mutex_lock(&x->lock);
+        quit = x->req_quit;
+        play = x->req_play;
+        req_speed = x->req_speed;
+        if (x->req_seek) {
+            position = x->req_position;
+            seek = 1;
+            x->req_seek = 0;
+        }
+        pthread_mutex_unlock(&x->lock);
+        if (quit)
+            break;
+
+        if (seek) {
+            double stamp = x->t0 + position;
+            n = lslplay_find(x, stamp);
+            for (i = 0; i < n && x->stamps[i] < stamp; ++i)
+                ;
+            seek = 0;
+            playing = 0;        // picks up the new anchor below
+            if (n <= 0) {
+                lslplay_ended(x, n ? STATE_ERROR : STATE_END);
+                continue;
+            } else {
+                lslplay_setstate(x, play ? STATE_PLAYING : STATE_PAUSED);
+                __atomic_store(&x->position, &position, __ATOMIC_RELAXED);
+            }
+        }
+        if (play && n <= 0) {
+            // play after the end (or an error) starts over
+            position = 0;
+            seek = 1;
+            continue;
+        }
+        if (n <= 0 || !play) {
+            if (playing && n > 0)
+                lslplay_setstate(x, STATE_PAUSED);
+            playing = 0;
+            lslpd_sleep(WORKER_SLEEP);
+            continue;
+        }
+        // (re)start, or change speed: the next sample is due now
+        if (!playing || req_speed != speed) {
+            double from = i < n ? x->stamps[i] : x->t0 + position;
+            anchor_file = from;
+            anchor_local = lsl_local_clock();
+            speed = req_speed;
+            playing = 1;
+            lslplay_setstate(x, STATE_PLAYING);
+        }
+        if (i == n) {
+            n = lslplay_next(x);
+            i = 0;
+            if (n <= 0) {
+                lslplay_ended(x, n ? STATE_ERROR : STATE_END);
+                playing = 0;
+            }
+            continue;
+        }
+        // push everything that is due in one chunk, stamped with its due time
+        {
+            double now = lsl_local_clock();
+            long j = i;
+            while (j < n && (x->due[j] = anchor_local + (x->stamps[j] - anchor_file) / speed) <= now)
+                j++;
+            if (j == i) {
+                double wait = x->due[i] - now;
+                lslpd_sleep(wait < WORKER_SLEEP ? wait : WORKER_SLEEP);
+                continue;
+            }
+            x->format->push_chunk_n(x->outlet, (char *)x->values + i * samplebytes,
+                (unsigned long)(j - i) * x->nchan, x->due + i);
+            position = x->stamps[j - 1] - x->t0;
+            __atomic_store(&x->position, &position, __ATOMIC_RELAXED);
+            i = j;
+        }
+    }
+    return NULL;
+}
+
+
+/* ==== Pd side ==== */
+
+static void lslplay_tick(t_lslplay *x){
+    int state = __atomic_load_n(&x->state, __ATOMIC_RELAXED);
+    double position;
+
+    __atomic_load(&x->position, &position, __ATOMIC_RELAXED);
+    if (position != x->reported_position) {
+        x->reported_position = position;
+        outlet_float(x->out_position, position);
+    }
+    if (state != x->reported_state) {
+        x->reported_state = state;
+        outlet_symbol(x->out_status, gensym(state_names[state]));
+    }
+    clock_delay(x->clock, REPORT_INTERVAL_MS);
+}
+
+// 'open <file>': stop what is playing, then read the file's stream header and
+// create the outlet; playback starts with 'play'
+void lslplay_open(t_lslplay *x, t_symbol *file){
+    char path[MAXPDSTRING];
+
+    lslplay_close(x);
+    canvas_makefilename(x->canvas, file->s_name, path, MAXPDSTRING);
+    if (!(x->file = fopen(path, "rb"))) {
+        pd_error(x, "lslplay: %s: %s", path, strerror(errno));
+        return;
+    }
+    x->file_buffer = (char *)lslpd_getbytes(READ_BUFFER_BYTES);
+    setvbuf(x->file, x->file_buffer, _IOFBF, READ_BUFFER_BYTES);
+    if (!lslplay_read_header(x)) {
+        lslplay_close(x);
+        return;
+    }
+    x->req_play = x->req_seek = x->req_quit = 0;
+    x->state = STATE_PAUSED;
+    x->position = 0;
+    if (pthread_create(&x->worker, NULL, lslplay_worker, x)) {
+        pd_error(x, "lslplay: could not start the player thread");
+        lslplay_close(x);
+        return;
+    }
+    x->worker_running = 1;
+    x->reported_state = -1;
+    x->reported_position = -1;
+    lslplay_tick(x);
+}
+
+static void lslplay_close(t_lslplay *x){
+    if (x->worker_running) {
+        pthread_mutex_lock(&x->lock);
+        x->req_quit = 1;
+        pthread_mutex_unlock(&x->lock);
+        pthread_join(x->worker, NULL);
+        x->worker_running = 0;
+    }
+    clock_unset(x->clock);
+    if (x->outlet)
+        lsl_destroy_outlet(x->outlet);
+    if (x->info)
+        lsl_destroy_streaminfo(x->info);
+    if (x->file)
+        fclose(x->file);
+    if (x->file_buffer)
+        lslpd_freebytes(x->file_buffer, READ_BUFFER_BYTES);
+    free(x->chunk);
+    free(x->values);
+    free(x->stamps);
+    free(x->due);
+    free(x->text);
+    x->outlet = NULL;
+    x->info = NULL;
+    x->file = NULL;
+    x->file_buffer = x->chunk = x->text = NULL;
+    x->values = NULL;
+    x->stamps = x->due = NULL;
+    x->chunk_size = x->frames = x->text_size = 0;
+}
+
+void lslplay_play(t_lslplay *x){
+    if (!x->worker_running) {
+        pd_error(x, "lslplay: no file open");
+        return;
+    }
+    pthread_mutex_lock(&x->lock);
+    x->req_play = 1;
+    pthread_mutex_unlock(&x->lock);
+}
+
+// pause; 'play' goes on from here
+void lslplay_stop(t_lslplay *x){
+    pthread_mutex_lock(&x->lock);
+    x->req_play = 0;
+    pthread_mutex_unlock(&x->lock);
+}
+
+// playback speed: 1 = real time, 10 = ten times faster
+void lslplay_speed(t_lslplay *x, t_floatarg f){
+    if (f <= 0) {
+        pd_error(x, "lslplay: the speed must be positive");
+        return;
+    }
+    pthread_mutex_lock(&x->lock);
+    x->req_speed = f;
+    pthread_mutex_unlock(&x->lock);
+}
+
+// jump to a position in seconds from the start of the recording
+void lslplay_seek(t_lslplay *x, t_floatarg f){
+    pthread_mutex_lock(&x->lock);
+    x->req_seek = 1;
+    x->req_position = f > 0 ? f : 0;
+    pthread_mutex_unlock(&x->lock);
+}
+
+void lslplay_free(t_lslplay *x){
+    lslplay_close(x);
+    clock_free(x->clock);
+    pthread_mutex_destroy(&x->lock);
+}
@@ -10,8 +10,11 @@
 
 #include "m_pd.h"      //pd header file
 #include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <pthread.h>
 
 
 
@@ -19,10 +22,29 @@
 #define DEFAULT_STREAM_TYPE "EEG"
 #define DEFAULT_DATA_TYPE "string"
 #define DEFAULT_NCHAN 1
-#define MAX_NCHAN 2000          //some unreaonably large value
 #define MAX_ARG_LENGTH 50
 #define MAX_DATA_TYPE_LENGTH 32
-#define POLLING_INTERVAL_MS 1   //poll stream this often (Q: is there any way to specify a callback?)
+#define POLLING_INTERVAL_MS 1   //shortest poll interval, used while a stream is busy
+#define MAX_POLL_INTERVAL_MS 32 //idle streams back off to polling this often
+#define POLL_SLACK_MS 0.5       //instances due this close together are serviced in the same pass
+#define RATE_SMOOTHING 0.25     //weight of the newest observation in the arrival rate estimate
+#define DEFAULT_MAX_PER_TICK 1024 //most samples emitted per poll, so a busy stream can't starve the scheduler
+#define WORKER_TIMEOUT 0.05     //seconds the receive thread blocks waiting for data
+#define RING_TICKS 4            //receive ring holds this many polls worth of samples
+#define DEFAULT_REDRAW_MS 50    //array mode: shortest time between array redraws
+#define MAX_ARRAY_NAME 1000     //array mode: room for "<prefix>-<channel>"
+#define LATEST_MAX_BUFFER 1     //latest-only mode: seconds liblsl buffers unless -maxbuffer says otherwise
+#define FULLINFO_TIMEOUT 2.0    //seconds the describing thread waits for the stream's description
+#define MAX_DESCRIBE_ATTEMPTS 2 //the description is fetched once, and retried once if that fails
+#define LABEL_PENDING -2        //a label can't be looked up until the description is in
+
+/* states reported on the status outlet */
+enum { STATUS_RESOLVING, STATUS_CONNECTED, STATUS_LOST };
+static const char *status_names[] = { "resolving", "connected", "lost" };
+
+/* reduce mode: what each output list holds per channel */
+enum { REDUCE_OFF, REDUCE_LAST, REDUCE_MEAN, REDUCE_MINMAX, REDUCE_RMS };
+static const char *reduce_names[] = { "off", "last", "mean", "minmax", "rms" };
  
 
 //typedef is used to give a type a new name
@@ -30,6 +52,27 @@
 
 static t_class *lslreceive_class;
 
+struct _lslreceive;
+
+/* one clock polls every lslreceive instance, each at its own adaptive interval */
+typedef struct _lslreceive_poller{
+    t_clock *clock;
+    double epoch;               /* logical time that poll times are measured from */
+    struct _lslreceive *list;   /* registered instances */
+    struct _lslreceive *next;   /* next instance of the pass in progress */
+} t_lslreceive_poller;
+
+static t_lslreceive_poller lslreceive_poller;
+
+/* fetches a stream's full description (with channel labels) in its own
+   thread, as it waits on the network */
+typedef struct _lslreceive_describer{
+    pthread_t thread;
+    lsl_inlet inlet;
+    lsl_streaminfo info;        /* the description, NULL if it couldn't be fetched */
+    int done;                   /* set by the thread once info is final */
+} t_lslreceive_describer;
+
 typedef struct _lslreceive{
 	t_object x_obj;
 
@@ -40,19 +83,82 @@ typedef struct _lslreceive{
     lsl_streaminfo* info;					/*streaminfo returned by the lsl_resolve_byprop call*/
 	
 	lsl_channel_format_t lsl_channel_format;
+    const t_lslpd_format *format;   /* pull and conversion routines for the format */
+    void (*output)(struct _lslreceive *x, double timestamp, void *sample);
 
 	lsl_inlet inlet;
 	int errcode;
 
 
-	t_outlet *out_data, *out_timestamp; 	/* outlets */
+	t_outlet *out_data, *out_timestamp, *out_status; 	/* outlets */
+
+    lsl_continuous_resolver resolver;   /* looks for the stream until it shows up */
+    int status;                 /* last state reported on the status outlet */
+
+
 
+    /* shared poller bookkeeping, in ms since the poller's epoch */
+    struct _lslreceive *poll_next;
+    double poll_due;            /* when this instance is serviced next */
+    double poll_interval;       /* current distance between polls */
+    double poll_last_data;      /* last poll that found samples */
+    double nominal_rate;        /* stream's nominal rate, 0 for irregular streams */
+    double arrival_rate;        /* smoothed observed sample rate */
 
+    /* output list and chunk buffers, sized for the stream's channel count
+       (and max_per_tick samples) */
+    t_atom *myList;
 
-	void * x_clock;
-    char* cursample_string[MAX_NCHAN];     /* array to hold our current sample string*/
-    float cursample_float[MAX_NCHAN];      /* array to hold our current sample float*/
-    t_atom myList[MAX_NCHAN];
+    /* string streams: by default every string becomes a symbol, which Pd keeps
+       forever. In byte mode strings go out as lists of byte values instead, and
+       only strings that repeat while still in a small LRU cache get a symbol. */
+    int bytes;
+    t_atom *byteList;           /* output list in byte mode, grown as needed */
+    int byteList_size;
+    t_lslpd_strcache cache;
+    int max_per_tick;           /* most samples pulled and emitted per poll */
+    int pending_max_per_tick;   /* new size requested by a 'maxpertick' message */
+    int chunk_frames;           /* samples the chunk buffers were allocated for (at least 2) */
+    void *chunk_data;           /* interleaved values in the format's C type */
+    double *chunk_timestamps;
+
+    /* threaded mode: a worker thread pulls into the chunk buffers and hands
+       timestamped frames over through a lock-free ring; the clock only drains it */
+    int threaded;
+    int worker_running;
+    int worker_quit;
+    pthread_t worker;
+    t_lslpd_ring ring;          /* frame = double timestamp + nchan values */
+
+    /* array mode: instead of a list per sample, channel k is written into the
+       garray "<prefix>-<k+1>" as a circular buffer and the position after the
+       last write goes out of an extra outlet. Redraws are rate limited. */
+    t_symbol *array_prefix;     /* NULL unless created with -arrays */
+    t_symbol **array_names;     /* one per channel, made once the stream is attached */
+    t_word **array_vecs;        /* looked up for every write; arrays may come and go */
+    int *array_sizes;
+    int *array_pos;             /* next index to write in each array */
+    float *array_frame;         /* one sample converted to float */
+    double array_written;       /* samples written since the arrays were named */
+    t_outlet *out_index;
+    t_clock *redraw_clock;
+    double redraw_interval;
+    double last_redraw;         /* logical time of the last redraw */
+
+    /* statistics for the 'stats' method: counters run all the time (the
+       worker adds to 'received'), rates and timings cover the time since the
+       previous report. With -stats there is an extra rightmost outlet that
+       reports periodically. */
+    unsigned long received;     /* samples pulled from liblsl */
+    unsigned long emitted;      /* samples output */
+    unsigned long lost_count;   /* times the stream was reported lost */
+    unsigned long recovered_count; /* ... and came back */
+    unsigned long stats_received;  /* 'received' at the previous report */
+    double stats_since;         /* logical time of the previous report */
+    t_lslpd_timing polltime;    /* time spent in lslreceive_getSample */
+    t_outlet *out_stats;
+    t_clock *stats_clock;
+    double stats_interval;      /* ms between periodic reports, 0 = off */
 	
     int lsl_nchan;              /* number of channels in the stream (speacified when creating object) */
       /* name of stream */
@@ -60,9 +166,58 @@ typedef struct _lslreceive{
 	lsl_streaminfo lsl_info;	 //the streaminfo returned by the resolve call 
 	lsl_inlet lsl_inlet;		/* a stream inlet to get samples from */
 	int lsl_errcode;			/* error code (lsl_lost_error or timeouts) */
-    float lsl_timestamp;		/* time stamp of the current sample (in sender time) */
+    double lsl_timestamp;		/* time stamp of the current sample (in sender time) */
+    t_atom stamp[LSLPD_STAMP_ATOMS];    /* the same, as it goes out of the left outlet */
+    unsigned postprocessing;    /* proc_* flags handed to liblsl */
+    double halftime;            /* dejitter smoothing half-time in s, 0 = liblsl default */
+    int max_buffer;             /* liblsl buffer: seconds (hundreds of samples for irregular streams) */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = sender's choice */
+    int latest;                 /* latest-only: each poll outputs just the newest sample and
+                                   drops the backlog, trading completeness for latency */
     double lsl_local_timestamp; /* tim estamp of receipt in local time */
 
+    /* reduce mode: numeric samples are folded into one list per poll, or per
+       reduce_every samples, instead of going out one by one. The list holds
+       each channel's last value, mean or RMS, or its min and max as a pair. */
+    int reduce;                 /* REDUCE_* */
+    int reduce_every;           /* samples per list, 0 = one list per poll */
+    int reduce_count;           /* samples folded in since the last list */
+    double reduce_stamp;        /* time stamp of the newest of them */
+    double *reduce_acc;         /* per channel value, sum, sum of squares or min; max after that */
+    float *reduce_frame;        /* one sample converted to float */
+    t_atom *reduce_list;        /* room for two values per channel */
+
+    /* channel selection: only the chosen channels are converted and output, as
+       runs of consecutive channels. The spec (1-based indices, "first-last"
+       ranges, "all" and channel labels) is kept as given and resolved once the
+       stream is attached, since labels come from the stream's description. */
+    t_atom *select_spec;
+    int select_nspec;
+    int *select_runs;           /* first channel and count of each run */
+    int select_nruns;
+    int nout;                   /* values per output sample */
+    int select_waiting;         /* the spec has labels and the description isn't in
+                                   yet: output is held until it is */
+
+    /* instances for the same stream with the same inlet settings share one
+       inlet: the first one (the leader) resolves, pulls and hands every sample
+       to the others, which the poller never services themselves */
+    struct _lslreceive *share_leader;   /* NULL for the leader */
+    struct _lslreceive *share_next;     /* next instance in the group */
+    struct _lslreceive *share_iter;     /* leader: next instance of the hand-out in progress */
+    int described;              /* lsl_info has the full description, with channel labels */
+    t_lslreceive_describer *describer;  /* leader: fetch in progress, or NULL */
+    int describe_attempts;
+
+    /* filter stage (float streams): the leader runs every pulled chunk through
+       a bank of biquads and/or a FIR, designed from the spec once the stream's
+       rate is known. Whichever thread pulls owns 'filter'; a 'filter' message
+       designs a new one and leaves it in 'filter_pending' for that thread. */
+    t_atom *filter_spec;
+    int filter_nspec;
+    t_lslpd_filter *filter;
+    t_lslpd_filter *filter_pending;
+
 } t_lslreceive;
 
 
@@ -71,13 +226,122 @@ void *lslreceive_new(t_symbol* s,long argc, t_atom* argv);
 // void lslreceive_bang(t_lslreceive *x);
 void lslreceive_free(t_lslreceive *x);
 void lslreceive_assist(t_lslreceive* x, void* b, long m, long a, char* s);
-void lslreceive_getSample(t_lslreceive *x);
+void lslreceive_getSample(t_lslreceive *x, double now);
+static void lslreceive_poll(t_lslreceive_poller *p);
+static void lslreceive_register(t_lslreceive *x);
+static void lslreceive_unregister(t_lslreceive *x);
+static void lslreceive_alloc_chunk(t_lslreceive *x);
+static void lslreceive_free_chunk(t_lslreceive *x);
+static void *lslreceive_worker(void *arg);
+static void lslreceive_resolve(t_lslreceive *x);
+void lslreceive_maxpertick(t_lslreceive *x, t_floatarg f);
+void lslreceive_stringmode(t_lslreceive *x, t_symbol *s);
+static void lslreceive_output_numeric(t_lslreceive *x, double timestamp, void *sample);
+static void lslreceive_output_string(t_lslreceive *x, double timestamp, void *sample);
+static void lslreceive_outstamp(t_lslreceive *x);
+void lslreceive_arrays(t_lslreceive *x, t_symbol *prefix);
+void lslreceive_redraw(t_lslreceive *x, t_floatarg f);
+static void lslreceive_redraw_arrays(t_lslreceive *x);
+static void lslreceive_free_arrays(t_lslreceive *x);
+void lslreceive_stats(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv);
+void lslreceive_latest(t_lslreceive *x, t_floatarg f);
+void lslreceive_reduce(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv);
+static void lslreceive_output_reduce(t_lslreceive *x, double timestamp, void *sample);
+static int lslreceive_reduce_mode(t_lslreceive *x, int argc, t_atom *argv);
+void lslreceive_channels(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv);
+static void lslreceive_set_spec(t_lslreceive *x, int argc, t_atom *argv);
+static void lslreceive_select(t_lslreceive *x);
+void lslreceive_filter(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv);
+static void lslreceive_set_filter(t_lslreceive *x, int argc, t_atom *argv);
+static t_lslreceive *lslreceive_find_leader(t_lslreceive *x);
+static void lslreceive_join(t_lslreceive *x, t_lslreceive *leader);
+static void lslreceive_stats_tick(t_lslreceive *x);
 
 
  
 void *lslreceive_new(t_symbol* s,long argc, t_atom* argv){
     t_lslreceive *x = (t_lslreceive *)pd_new(lslreceive_class);
+    t_lslreceive *leader;
+    int cache_size = LSLPD_STRCACHE_SIZE;
+
+    x->max_per_tick = DEFAULT_MAX_PER_TICK;
+    x->redraw_interval = DEFAULT_REDRAW_MS;
 
+    /* Flags (-maxpertick <samples>, -threaded, -bytes, -cache <strings>, -clocksync,
+       -dejitter, -monotonize, -halftime <seconds>, -arrays <prefix>, -redraw <ms>,
+       -stats <ms>, -maxbuffer <seconds>, -chunk <samples>, -latest,
+       -reduce <mode> [<samples>], -channels <channels...>, -filter <stages...>)
+       may follow the stream arguments */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-maxpertick") && i + 1 < argc) {
+            x->max_per_tick = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-threaded")) {
+            x->threaded = 1;
+        } else if (!strcmp(flag, "-bytes")) {
+            x->bytes = 1;
+        } else if (!strcmp(flag, "-cache") && i + 1 < argc) {
+            cache_size = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-clocksync")) {
+            x->postprocessing |= proc_clocksync;
+        } else if (!strcmp(flag, "-dejitter")) {
+            x->postprocessing |= proc_dejitter;
+        } else if (!strcmp(flag, "-monotonize")) {
+            x->postprocessing |= proc_monotonize;
+        } else if (!strcmp(flag, "-halftime") && i + 1 < argc) {
+            x->halftime = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-arrays") && i + 1 < argc) {
+            x->array_prefix = atom_getsymbol(&argv[++i]);
+        } else if (!strcmp(flag, "-redraw") && i + 1 < argc) {
+            x->redraw_interval = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-stats") && i + 1 < argc) {
+            x->stats_interval = atom_getfloat(&argv[++i]);
+            x->stats_clock = clock_new(x, (t_method)lslreceive_stats_tick);
+        } else if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+            if (x->max_buffer < 1) {
+                post("Warning: -maxbuffer must be at least 1; using the default");
+                x->max_buffer = 0;
+            }
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-latest")) {
+            x->latest = 1;
+        } else if (!strcmp(flag, "-reduce") && i + 1 < argc) {
+            int n = i + 2 < argc && argv[i + 2].a_type == A_FLOAT ? 2 : 1;
+            lslreceive_reduce_mode(x, n, argv + i + 1);
+            i += n;
+        } else if (!strcmp(flag, "-channels")) {
+            int n = 0;
+            while (i + 1 + n < argc && !(argv[i + 1 + n].a_type == A_SYMBOL &&
+                    atom_getsymbol(&argv[i + 1 + n])->s_name[0] == '-'))
+                n++;
+            lslreceive_set_spec(x, n, argv + i + 1);
+            i += n;
+        } else if (!strcmp(flag, "-filter")) {
+            int n = 0;
+            while (i + 1 + n < argc && !(argv[i + 1 + n].a_type == A_SYMBOL &&
+                    atom_getsymbol(&argv[i + 1 + n])->s_name[0] == '-'))
+                n++;
+            if (lslpd_filter_check(n, argv + i + 1, x, "lslreceive"))
+                lslreceive_set_filter(x, n, argv + i + 1);
+            i += n;
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    argc = npos;
+    if (x->max_per_tick < 1)
+        x->max_per_tick = 1;
+    lslpd_strcache_init(&x->cache, cache_size);
+    if (x->max_chunk < 0)
+        x->max_chunk = LSL_NO_PREFERENCE;
+    if (!x->max_buffer)
+        x->max_buffer = x->latest ? LATEST_MAX_BUFFER : LSLPD_MAX_BUFFER;
+    x->pending_max_per_tick = x->max_per_tick;
 
     /* Collect arguments in order to connect to stream */
 
@@ -98,14 +362,10 @@ void *lslreceive_new(t_symbol* s,long argc, t_atom* argv){
     /* Number of Channels */
     if (argc>=3 && argv[2].a_type==A_FLOAT) {
         x->lsl_nchan = atom_getint(&argv[2]);
-        if (x->lsl_nchan < 0) {
+        if (x->lsl_nchan < 1) {
             x->lsl_nchan = 1;
             post("Warning: Must specify at least one channel. Defaulting to one channel.");
         }
-        if (x->lsl_nchan > MAX_NCHAN) {
-            x->lsl_nchan = MAX_NCHAN;
-            post("Warning: Limiting the specified large number of channels to the maximum of 2000");
-        }
     } else {
         post(" Using default number of channels (%d).",DEFAULT_NCHAN);
         x->lsl_nchan = DEFAULT_NCHAN;
@@ -118,15 +378,30 @@ void *lslreceive_new(t_symbol* s,long argc, t_atom* argv){
         post(" Using default data type (%s)",x->data_type);
     }
 
-    // handle data-type specifics
-    if (!strcmp(x->data_type, "string") || !strcmp(x->data_type, "string32")) {
-        x->lsl_channel_format = cft_string;
-    } else if (!strcmp(x->data_type, "float") || !strcmp(x->data_type, "float32")) {
-        x->lsl_channel_format = cft_float32;
-    } else {
+    // handle data-type specifics; liblsl converts from the stream's own format
+    if (!(x->format = lslpd_format_byname(x->data_type))) {
         post("ERROR: Unsupported data type (%s)",x->data_type);
         return NULL;
     }
+    x->lsl_channel_format = x->format->format;
+    x->output = x->lsl_channel_format == cft_string ? lslreceive_output_string : lslreceive_output_numeric;
+    if (x->array_prefix && !x->format->to_float) {
+        post("Warning: %s streams can't be written to arrays; ignoring -arrays", x->data_type);
+        x->array_prefix = NULL;
+    }
+    if (x->reduce && !x->format->to_float) {
+        post("Warning: %s streams can't be reduced; ignoring -reduce", x->data_type);
+        x->reduce = REDUCE_OFF;
+    } else if (x->reduce && x->array_prefix) {
+        post("Warning: array mode writes every sample; ignoring -reduce");
+        x->reduce = REDUCE_OFF;
+    }
+    if (x->reduce)
+        x->output = lslreceive_output_reduce;
+    if (x->filter_nspec && x->lsl_channel_format != cft_float32) {
+        post("Warning: only float streams can be filtered; ignoring -filter");
+        lslreceive_set_filter(x, 0, NULL);
+    }
 
     post("LSL INFO:");
     post("Stream Name: %s", x->lsl_stream_name);
@@ -135,20 +410,34 @@ void *lslreceive_new(t_symbol* s,long argc, t_atom* argv){
     post("Channel Format: %s", x->data_type);
     post("data_type=%s, lsl_channel_format=%d",x->data_type, x->lsl_channel_format);
     post("Listening for stream...");
-	x->lsl_info = lsl_create_streaminfo(x->lsl_stream_name,x->lsl_stream_type,x->lsl_nchan,0,x->lsl_channel_format,"");
-    x->lsl_inlet = lsl_create_inlet(x->lsl_info, 300, LSL_NO_PREFERENCE, 1);
 
- 	if (x->lsl_inlet) {
-        /*Create oulets*/
-        x->out_timestamp = outlet_new(&x->x_obj, &s_float); /* Left: timestamp */
-        x->out_data = outlet_new(&x->x_obj, &s_list);       /* Right: data */
+    /*Create oulets*/
+    x->out_timestamp = outlet_new(&x->x_obj, LSLPD_STAMP_ATOMS > 1 ? &s_list : &s_float); /* Left: timestamp */
+    x->out_data = outlet_new(&x->x_obj, &s_list);       /* Middle: data */
+    x->out_status = outlet_new(&x->x_obj, &s_symbol);   /* Right: connection status */
+    if (x->array_prefix) {
+        x->out_index = outlet_new(&x->x_obj, &s_float); /* Array mode: write index */
+        x->redraw_clock = clock_new(x, (t_method)lslreceive_redraw_arrays);
+    }
+    if (x->stats_clock) {
+        x->out_stats = outlet_new(&x->x_obj, 0);        /* Rightmost: statistics */
+        if (x->stats_interval > 0)
+            clock_delay(x->stats_clock, x->stats_interval);
+    }
+    x->stats_since = clock_getlogicaltime();
 
-         // Polling functions 
-        x->x_clock  = clock_new((t_object *)x, (t_method)lslreceive_getSample);
-        clock_delay(x->x_clock, POLLING_INTERVAL_MS);
-    } else {
-        post("No matching stream was found. Make sure the information matches stream source.");
+    // the stream is looked up in the background; the shared poller attaches
+    // the inlet once it shows up and then switches to polling for samples.
+    // If another instance already listens to it the same way, join that one.
+    x->status = STATUS_RESOLVING;
+    if ((leader = lslreceive_find_leader(x))) {
+        lslreceive_join(x, leader);
+        return (void *)x;
     }
+    x->resolver = lslpd_resolver_new(x->lsl_stream_name);
+    if (!x->resolver)
+        post("Problem creating the stream resolver. No stream will be found.");
+    lslreceive_register(x);
 
 	return (void *)x;
 }
@@ -164,6 +453,16 @@ void lslreceive_setup(void) {
 							    A_GIMME,
 							   	0);  
   	
+  class_addmethod(lslreceive_class, (t_method)lslreceive_maxpertick, gensym("maxpertick"), A_FLOAT, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_stringmode, gensym("stringmode"), A_SYMBOL, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_arrays, gensym("arrays"), A_SYMBOL, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_redraw, gensym("redraw"), A_FLOAT, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_stats, gensym("stats"), A_GIMME, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_latest, gensym("latest"), A_FLOAT, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_reduce, gensym("reduce"), A_GIMME, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_channels, gensym("channels"), A_GIMME, 0);
+  class_addmethod(lslreceive_class, (t_method)lslreceive_filter, gensym("filter"), A_GIMME, 0);
+
   //bangs aren't really needed right now
   // class_addbang(lslreceive_class, (t_method)lslreceive_bang);  
 }
@@ -175,75 +474,1169 @@ void lslreceive_setup(void) {
 
 // }
 
-void lslreceive_getSample(t_lslreceive *x){
-	int errcode;
+// chunk buffers hold max_per_tick samples of nchan channels (and at least
+// two, for latest-only mode)
+static void lslreceive_alloc_chunk(t_lslreceive *x){
+    size_t frames = x->chunk_frames = x->max_per_tick > 2 ? x->max_per_tick : 2;
+    x->chunk_data = lslpd_getbytes(frames * x->lsl_nchan * x->format->value_bytes);
+    x->chunk_timestamps = (double *)lslpd_getbytes(frames * sizeof(double));
+}
 
-    switch (x->lsl_channel_format) {
-	    case cft_string:
-	        x->lsl_timestamp = lsl_pull_sample_str(x->lsl_inlet,x->cursample_string,1,0.0,&errcode);
-	        break;
-	    case cft_float32:
-	        x->lsl_timestamp = lsl_pull_sample_f(x->lsl_inlet,x->cursample_float,x->lsl_nchan,0,&errcode);
-	        break;
-	        
-	    default:
-	        x->lsl_timestamp = 0; //should never reach
-	        break;
-		}
-
-	while (x->lsl_timestamp>0)	{
-        //post("%f", x->lsl_timestamp);
-		// post ("%s  %s  %s  %s  %s  %s  %s  %s",x->cursample[0],x->cursample[1],x->cursample[2],x->cursample[3],x->cursample[4],x->cursample[5],x->cursample[6],x->cursample[7]);
-
-        // create list depending on data type received
-        switch (x->lsl_channel_format) {
-            case cft_string:
-                // return list of strings, for flexibility, and consumer can use [fromsymbol] to convert to numbers
-                for (int k=0; k < 1; ++k) {
-                    SETSYMBOL(x->myList+k,gensym(x->cursample_string[k])); 
-                }
-                break;
-                
-            case cft_float32:
-                // return list of strings, for flexibility, and consumer can use [fromsymbol] to convert to numbers
-                for (int k=0; k < x->lsl_nchan; ++k) {
-                    SETFLOAT(x->myList+k,x->cursample_float[k]);
-                }
-                break;
-                
-            default:
-                break;
+static void lslreceive_free_chunk(t_lslreceive *x){
+    size_t frames = x->chunk_frames;
+    if (x->chunk_data)
+        lslpd_freebytes(x->chunk_data, frames * x->lsl_nchan * x->format->value_bytes);
+    if (x->chunk_timestamps)
+        lslpd_freebytes(x->chunk_timestamps, frames * sizeof(double));
+    x->chunk_data = NULL;
+    x->chunk_timestamps = NULL;
+}
+
+// takes effect on the next poll, since we may be called from inside our own
+// outlet; instances sharing an inlet share this setting
+void lslreceive_maxpertick(t_lslreceive *x, t_floatarg f){
+    t_lslreceive *leader = x->share_leader ? x->share_leader : x;
+    leader->pending_max_per_tick = f < 1 ? 1 : (int)f;
+}
+
+// "stringmode symbol" or "stringmode bytes"
+void lslreceive_stringmode(t_lslreceive *x, t_symbol *s){
+    if (!strcmp(s->s_name, "bytes"))
+        x->bytes = 1;
+    else if (!strcmp(s->s_name, "symbol"))
+        x->bytes = 0;
+    else
+        pd_error(x, "lslreceive: unknown string mode '%s' (use 'symbol' or 'bytes')", s->s_name);
+}
+
+// array mode: "arrays <prefix>" switches to another set of arrays
+void lslreceive_arrays(t_lslreceive *x, t_symbol *prefix){
+    char name[MAX_ARRAY_NAME];
+
+    if (!x->out_index) {
+        pd_error(x, "lslreceive: create the object with -arrays to write to arrays");
+        return;
+    }
+    x->array_prefix = prefix;
+    x->array_written = 0;
+    if (!x->array_names)
+        return;     // not attached yet; named once the channel count is known
+    // arrays are named after the stream's channel numbers, selected or not
+    for (int r = 0, j = 0; r < x->select_nruns; ++r) {
+        for (int k = x->select_runs[2 * r]; k < x->select_runs[2 * r] + x->select_runs[2 * r + 1]; ++k, ++j) {
+            snprintf(name, MAX_ARRAY_NAME, "%s-%d", prefix->s_name, k + 1);
+            x->array_names[j] = gensym(name);
         }
+    }
+}
 
-        outlet_float(x->out_timestamp, x->lsl_timestamp);
-		outlet_list(x->out_data,0L,x->lsl_nchan,x->myList);
-        
-        switch (x->lsl_channel_format) {
-            case cft_string:
-                x->lsl_timestamp = lsl_pull_sample_str(x->lsl_inlet,x->cursample_string,x->lsl_nchan,0,&errcode);
-                break;
-                
-            case cft_float32:
-                x->lsl_timestamp = lsl_pull_sample_f(x->lsl_inlet,x->cursample_float,x->lsl_nchan,0,&errcode);
-                break;
-            default:
-                x->lsl_timestamp = 0;
-                break;
+// array mode: "redraw <ms>" sets the shortest time between redraws
+void lslreceive_redraw(t_lslreceive *x, t_floatarg f){
+    x->redraw_interval = f < 0 ? 0 : f;
+}
+
+static void lslreceive_alloc_arrays(t_lslreceive *x){
+    int nchan = x->lsl_nchan;
+
+    x->array_names = (t_symbol **)lslpd_getbytes(nchan * sizeof(t_symbol *));
+    x->array_vecs = (t_word **)lslpd_getbytes(nchan * sizeof(t_word *));
+    x->array_sizes = (int *)lslpd_getbytes(nchan * sizeof(int));
+    x->array_pos = (int *)lslpd_getbytes(nchan * sizeof(int));
+    x->array_frame = (float *)lslpd_getbytes(nchan * sizeof(float));
+    lslreceive_arrays(x, x->array_prefix);
+}
+
+static void lslreceive_free_arrays(t_lslreceive *x){
+    int nchan = x->lsl_nchan;
+
+    if (x->redraw_clock)
+        clock_free(x->redraw_clock);
+    if (!x->array_names)
+        return;
+    lslpd_freebytes(x->array_names, nchan * sizeof(t_symbol *));
+    lslpd_freebytes(x->array_vecs, nchan * sizeof(t_word *));
+    lslpd_freebytes(x->array_sizes, nchan * sizeof(int));
+    lslpd_freebytes(x->array_pos, nchan * sizeof(int));
+    lslpd_freebytes(x->array_frame, nchan * sizeof(float));
+}
+
+static void lslreceive_redraw_arrays(t_lslreceive *x){
+    t_garray *a;
+
+    for (int k = 0; k < x->nout; ++k)
+        if ((a = (t_garray *)pd_findbyclass(x->array_names[k], garray_class)))
+            garray_redraw(a);
+    x->last_redraw = clock_getlogicaltime();
+}
+
+// convert the selected channels of one sample to float, in output order
+static void lslreceive_tofloat(t_lslreceive *x, float *dst, const char *sample){
+    size_t bytes = x->format->value_bytes;
+
+    for (int r = 0; r < x->select_nruns; ++r) {
+        int first = x->select_runs[2 * r], count = x->select_runs[2 * r + 1];
+        x->format->to_float(dst, sample + first * bytes, count);
+        dst += count;
+    }
+}
+
+// array mode: write n samples (each 'stride' bytes apart) into the channel
+// arrays, then report the write index and schedule a redraw
+static void lslreceive_write_arrays(t_lslreceive *x, const char *values, size_t stride, size_t n, double timestamp){
+    int nchan = x->nout;
+    double since;
+    t_garray *a;
+
+    for (int k = 0; k < nchan; ++k) {
+        a = (t_garray *)pd_findbyclass(x->array_names[k], garray_class);
+        if (!a || !garray_getfloatwords(a, &x->array_sizes[k], &x->array_vecs[k]) || x->array_sizes[k] < 1)
+            x->array_vecs[k] = NULL;
+        else
+            x->array_pos[k] = (int)fmod(x->array_written, x->array_sizes[k]);
+    }
+    for (size_t i = 0; i < n; ++i, values += stride) {
+        lslreceive_tofloat(x, x->array_frame, values);
+        for (int k = 0; k < nchan; ++k) {
+            if (!x->array_vecs[k])
+                continue;
+            x->array_vecs[k][x->array_pos[k]].w_float = x->array_frame[k];
+            if (++x->array_pos[k] == x->array_sizes[k])
+                x->array_pos[k] = 0;
         }
-	}
-	clock_delay(x->x_clock, POLLING_INTERVAL_MS);
+    }
+    x->array_written += n;
 
+    x->lsl_timestamp = timestamp;
+    since = clock_gettimesince(x->last_redraw);
+    if (since >= x->redraw_interval)
+        lslreceive_redraw_arrays(x);
+    else
+        clock_delay(x->redraw_clock, x->redraw_interval - since);
+    outlet_float(x->out_index, x->array_vecs[0] ? x->array_pos[0] : x->array_written);
+    lslreceive_outstamp(x);
+}
+
+// byte mode: each selected channel's string as one symbol (if cached) or its
+// byte values, with channels separated by a 0; returns the number of atoms
+static int lslreceive_bytes(t_lslreceive *x, char **values){
+    int natoms = 0, j = 0;
+    size_t need = x->nout;
+
+    for (int r = 0; r < x->select_nruns; ++r)
+        for (int k = x->select_runs[2 * r]; k < x->select_runs[2 * r] + x->select_runs[2 * r + 1]; ++k)
+            need += strlen(values[k]);
+    if (need > (size_t)x->byteList_size) {
+        if (x->byteList)
+            lslpd_freebytes(x->byteList, x->byteList_size * sizeof(t_atom));
+        x->byteList_size = need;
+        x->byteList = (t_atom *)lslpd_getbytes(need * sizeof(t_atom));
+    }
+    for (int r = 0; r < x->select_nruns; ++r) {
+        for (int k = x->select_runs[2 * r]; k < x->select_runs[2 * r] + x->select_runs[2 * r + 1]; ++k, ++j) {
+            // (SETFLOAT evaluates its atom argument twice)
+            if (j) {
+                SETFLOAT(x->byteList + natoms, 0);
+                natoms++;
+            }
+            natoms += lslpd_string_to_atoms(&x->cache, x->byteList + natoms, values[k], strlen(values[k]));
+        }
+    }
+    return natoms;
+}
+
+// run n freshly pulled samples through the filter stage, in whichever thread
+// pulls them; a filter designed by a 'filter' message replaces the current
+// one here, so the two are never touched from different threads at once
+static void lslreceive_run_filter(t_lslreceive *x, float *frames, unsigned long n){
+    t_lslpd_filter *f;
+
+    if (__atomic_load_n(&x->filter_pending, __ATOMIC_RELAXED) &&
+        (f = __atomic_exchange_n(&x->filter_pending, NULL, __ATOMIC_ACQUIRE))) {
+        lslpd_filter_free(x->filter);
+        if (!f->nsections && !f->ntaps) {
+            lslpd_filter_free(f);
+            f = NULL;
+        }
+        x->filter = f;
+    }
+    if (x->filter)
+        lslpd_filter_run(x->filter, frames, n);
+}
+
+// pull up to maxframes samples into the chunk buffers, starting at sample
+// 'offset'; returns the number of samples
+static unsigned long lslreceive_pull(t_lslreceive *x, unsigned long offset, unsigned long maxframes, double timeout){
+    unsigned long nchan = x->lsl_nchan;
+    int errcode = 0;
+    unsigned long n;
+    char *values = (char *)x->chunk_data + offset * nchan * x->format->value_bytes;
+
+    n = x->format->pull_chunk(x->lsl_inlet, values,
+        x->chunk_timestamps + offset, maxframes * nchan, maxframes, timeout, &errcode) / nchan;
+    __atomic_store_n(&x->lsl_errcode, errcode, __ATOMIC_RELAXED);
+    if (n)
+        __atomic_fetch_add(&x->received, n, __ATOMIC_RELAXED);
+    lslreceive_run_filter(x, (float *)values, n);
+    return n;
+}
+
+// release n samples ('stride' bytes apart) that have been output, or won't be
+static void lslreceive_drop(t_lslreceive *x, char *values, size_t stride, size_t n){
+    if (x->lsl_channel_format != cft_string)
+        return;
+    for (size_t i = 0; i < n; ++i, values += stride)
+        for (int k = 0; k < x->lsl_nchan; ++k)
+            lsl_destroy_string(((char **)values)[k]);
+}
+
+// latest-only mode: of the n samples at the start of the chunk buffers keep
+// just the newest, pulling and dropping whatever else liblsl holds; returns
+// the number of samples left (1, or 0 if there were none)
+static unsigned long lslreceive_skip(t_lslreceive *x, unsigned long n){
+    size_t samplebytes = x->lsl_nchan * x->format->value_bytes;
+    char *values = (char *)x->chunk_data;
+
+    while (n > 1) {
+        lslreceive_drop(x, values, samplebytes, n - 1);
+        memcpy(values, values + (n - 1) * samplebytes, samplebytes);
+        x->chunk_timestamps[0] = x->chunk_timestamps[n - 1];
+        n = 1;
+        if (lsl_samples_available(x->lsl_inlet))
+            n += lslreceive_pull(x, 1, x->chunk_frames - 1, 0.0);
+    }
+    return n;
+}
+
+// time stamp on the left outlet (hi/lo pair on single-precision builds)
+static void lslreceive_outstamp(t_lslreceive *x){
+    int n = lslpd_stamp_to_atoms(x->stamp, x->lsl_timestamp);
+    if (n == 1)
+        outlet_float(x->out_timestamp, atom_getfloat(x->stamp));
+    else
+        outlet_list(x->out_timestamp, 0L, n, x->stamp);
+}
+
+// output the selected channels of one sample (values of the stream's format)
+// and its time stamp; one of these is picked as x->output when the object is
+// created. String samples are released by the caller.
+static void lslreceive_output_numeric(t_lslreceive *x, double timestamp, void *sample){
+    size_t bytes = x->format->value_bytes;
+    t_atom *a = x->myList;
+
+    x->lsl_timestamp = timestamp;
+    lslreceive_outstamp(x);
+    for (int r = 0; r < x->select_nruns; ++r) {
+        int first = x->select_runs[2 * r], count = x->select_runs[2 * r + 1];
+        x->format->to_atoms(a, (char *)sample + first * bytes, count);
+        a += count;
+    }
+	outlet_list(x->out_data,0L,x->nout,x->myList);
+}
+
+static void lslreceive_output_string(t_lslreceive *x, double timestamp, void *sample){
+    char **values = (char **)sample;
+    int j = 0;
+
+    x->lsl_timestamp = timestamp;
+    lslreceive_outstamp(x);
+    if (x->bytes) {
+        int natoms = lslreceive_bytes(x, values);
+        outlet_list(x->out_data, 0L, natoms, x->byteList);
+        return;
+    }
+    // return list of strings, for flexibility, and consumer can use [fromsymbol] to convert to numbers
+    for (int r = 0; r < x->select_nruns; ++r)
+        for (int k = x->select_runs[2 * r]; k < x->select_runs[2 * r] + x->select_runs[2 * r + 1]; ++k, ++j)
+            SETSYMBOL(x->myList + j, gensym(values[k]));
+    outlet_list(x->out_data,0L,x->nout,x->myList);
+}
+
+// reduce buffers are sized for every channel, so any selection fits
+static void lslreceive_alloc_reduce(t_lslreceive *x){
+    int nchan = x->lsl_nchan;
+
+    if (x->reduce_acc)
+        return;
+    x->reduce_acc = (double *)lslpd_getbytes(2 * nchan * sizeof(double));
+    x->reduce_frame = (float *)lslpd_getbytes(nchan * sizeof(float));
+    x->reduce_list = (t_atom *)lslpd_getbytes(2 * nchan * sizeof(t_atom));
+}
+
+static void lslreceive_free_reduce(t_lslreceive *x){
+    int nchan = x->lsl_nchan;
+
+    if (!x->reduce_acc)
+        return;
+    lslpd_freebytes(x->reduce_acc, 2 * nchan * sizeof(double));
+    lslpd_freebytes(x->reduce_frame, nchan * sizeof(float));
+    lslpd_freebytes(x->reduce_list, 2 * nchan * sizeof(t_atom));
+}
+
+// reduce mode: output the aggregate of the samples folded in so far
+static void lslreceive_reduce_flush(t_lslreceive *x){
+    int nchan = x->nout, n = nchan;
+    double *acc = x->reduce_acc, count = x->reduce_count;
+
+    for (int k = 0; k < nchan; ++k) {
+        switch (x->reduce) {
+        case REDUCE_MEAN:
+            SETFLOAT(x->reduce_list + k, acc[k] / count);
+            break;
+        case REDUCE_RMS:
+            SETFLOAT(x->reduce_list + k, sqrt(acc[k] / count));
+            break;
+        case REDUCE_MINMAX:
+            SETFLOAT(x->reduce_list + 2 * k, acc[k]);
+            SETFLOAT(x->reduce_list + 2 * k + 1, acc[nchan + k]);
+            n = 2 * nchan;
+            break;
+        default:
+            SETFLOAT(x->reduce_list + k, acc[k]);
+        }
+    }
+    // reset first; the outlets may fold in more samples before they return
+    x->reduce_count = 0;
+    x->lsl_timestamp = x->reduce_stamp;
+    lslreceive_outstamp(x);
+    outlet_list(x->out_data, 0L, n, x->reduce_list);
+}
+
+// reduce mode's x->output: fold one sample into the aggregate, and output it
+// once reduce_every samples are in (per-poll lists go out after the poll)
+static void lslreceive_output_reduce(t_lslreceive *x, double timestamp, void *sample){
+    int nchan = x->nout;
+    double *acc = x->reduce_acc;
+    float *v = x->reduce_frame;
+
+    lslreceive_tofloat(x, v, sample);
+    if (!x->reduce_count) {
+        for (int k = 0; k < nchan; ++k)
+            acc[k] = acc[nchan + k] = x->reduce == REDUCE_MEAN || x->reduce == REDUCE_RMS ? 0 : v[k];
+    }
+    switch (x->reduce) {
+    case REDUCE_MEAN:
+        for (int k = 0; k < nchan; ++k)
+            acc[k] += v[k];
+        break;
+    case REDUCE_RMS:
+        for (int k = 0; k < nchan; ++k)
+            acc[k] += (double)v[k] * v[k];
+        break;
+    case REDUCE_MINMAX:
+        for (int k = 0; k < nchan; ++k) {
+            if (v[k] < acc[k])
+                acc[k] = v[k];
+            if (v[k] > acc[nchan + k])
+                acc[nchan + k] = v[k];
+        }
+        break;
+    default:
+        for (int k = 0; k < nchan; ++k)
+            acc[k] = v[k];
+    }
+    x->reduce_stamp = timestamp;
+    if (++x->reduce_count >= x->reduce_every && x->reduce_every)
+        lslreceive_reduce_flush(x);
+}
+
+static void lslreceive_setstatus(t_lslreceive *x, int status){
+    if (status != x->status) {
+        if (status == STATUS_LOST)
+            x->lost_count++;
+        else if (x->status == STATUS_LOST)
+            x->recovered_count++;
+        x->status = status;
+        outlet_symbol(x->out_status, gensym(status_names[status]));
+    }
+}
+
+static int lslreceive_start_worker(t_lslreceive *x){
+    x->worker_quit = 0;
+    return !pthread_create(&x->worker, NULL, lslreceive_worker, x);
+}
+
+static void *lslreceive_describe_thread(void *arg){
+    t_lslreceive_describer *d = (t_lslreceive_describer *)arg;
+    int errcode = 0;
+    lsl_streaminfo info = lsl_get_fullinfo(d->inlet, FULLINFO_TIMEOUT, &errcode);
+
+    if (info && errcode) {
+        lsl_destroy_streaminfo(info);
+        info = NULL;
+    }
+    d->info = info;
+    __atomic_store_n(&d->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// start fetching the leader's description; the poll picks it up once it is in
+static void lslreceive_describe(t_lslreceive *leader){
+    t_lslreceive_describer *d = (t_lslreceive_describer *)lslpd_getbytes(sizeof(*d));
+
+    leader->describe_attempts++;
+    if (d) {
+        d->inlet = leader->lsl_inlet;
+        if (!pthread_create(&d->thread, NULL, lslreceive_describe_thread, d)) {
+            leader->describer = d;
+            return;
+        }
+        lslpd_freebytes(d, sizeof(*d));
+    }
+    leader->describe_attempts = MAX_DESCRIBE_ATTEMPTS;
+    post("Warning: could not fetch the description of stream '%s'", leader->lsl_stream_name);
+}
+
+// wait for a fetch to end and take its description; only blocks if it
+// hasn't, e.g. when the leader is freed in the middle of one
+static void lslreceive_describe_end(t_lslreceive *leader){
+    t_lslreceive_describer *d = leader->describer;
+
+    pthread_join(d->thread, NULL);
+    if (d->info) {
+        lsl_destroy_streaminfo(leader->lsl_info);
+        leader->lsl_info = d->info;
+        leader->described = 1;
+    } else if (leader->describe_attempts >= MAX_DESCRIBE_ATTEMPTS) {
+        post("Warning: could not get the description of stream '%s'", leader->lsl_stream_name);
+    }
+    lslpd_freebytes(d, sizeof(*d));
+    leader->describer = NULL;
+}
+
+// the description is in (or won't come): selections waiting for it are
+// resolved now, arrays renamed after the channels they got
+static void lslreceive_described(t_lslreceive *leader){
+    t_lslreceive *m;
+
+    lslreceive_describe_end(leader);
+    for (m = leader; m; m = m->share_next) {
+        if (m->select_waiting) {
+            lslreceive_select(m);
+            if (m->array_names && !m->select_waiting)
+                lslreceive_arrays(m, m->array_prefix);
+        }
+    }
+}
+
+// index of the channel with this label in the stream's description, or -1.
+// Resolved stream infos come without one, so the first lookup starts fetching
+// it in the background and returns LABEL_PENDING until it is in.
+static int lslreceive_label(t_lslreceive *leader, const char *label){
+    lsl_xml_ptr ch;
+    int k = 0;
+
+    if (!leader->described && leader->lsl_inlet && leader->describe_attempts < MAX_DESCRIBE_ATTEMPTS) {
+        if (!leader->describer)
+            lslreceive_describe(leader);
+        if (leader->describer)
+            return LABEL_PENDING;
+    }
+    ch = lsl_child(lsl_child(lsl_get_desc(leader->lsl_info), "channels"), "channel");
+    for (; ch && !lsl_empty(ch); ch = lsl_next_sibling_n(ch, "channel"), ++k)
+        if (!strcmp(lsl_child_value_n(ch, "label"), label))
+            return k;
+    return -1;
+}
+
+// turn the selection spec into runs of channels; without one (or when none of
+// it matches) every channel is output. While labels wait for the stream's
+// description nothing is.
+static void lslreceive_select(t_lslreceive *x){
+    t_lslreceive *leader = x->share_leader ? x->share_leader : x;
+    int nchan = x->lsl_nchan, *runs = x->select_runs, n = 0, nruns = 0, waiting = 0;
+    char buf[MAXPDSTRING];
+
+    for (int i = 0; i < x->select_nspec; ++i) {
+        t_atom *a = x->select_spec + i;
+        int first, last;
+        char rest;
+        if (a->a_type == A_FLOAT) {
+            first = last = atom_getint(a) - 1;
+        } else if (!strcmp(atom_getsymbol(a)->s_name, "all")) {
+            first = 0;
+            last = nchan - 1;
+        } else if (sscanf(atom_getsymbol(a)->s_name, "%d-%d%c", &first, &last, &rest) == 2) {
+            first--;
+            last--;
+        } else {
+            first = last = lslreceive_label(leader, atom_getsymbol(a)->s_name);
+            if (first == LABEL_PENDING) {
+                waiting = 1;
+                continue;
+            }
+        }
+        if (first < 0 || last >= nchan || first > last) {
+            atom_string(a, buf, MAXPDSTRING);
+            pd_error(x, "lslreceive: stream '%s' has no channel(s) '%s'", x->lsl_stream_name, buf);
+            continue;
+        }
+        for (int k = first; k <= last && n < nchan; ++k, ++n) {
+            if (nruns && runs[2 * nruns - 2] + runs[2 * nruns - 1] == k) {
+                runs[2 * nruns - 1]++;
+            } else {
+                runs[2 * nruns] = k;
+                runs[2 * nruns + 1] = 1;
+                nruns++;
+            }
+        }
+    }
+    if (!n) {
+        runs[0] = 0;
+        runs[1] = n = nchan;
+        nruns = 1;
+    }
+    x->select_nruns = nruns;
+    x->select_waiting = waiting;
+    x->nout = n;
+    x->reduce_count = 0;
+}
+
+// buffers for what an instance outputs, once the stream's channel count is
+// known; they are sized for every channel, so any selection fits
+static void lslreceive_alloc_output(t_lslreceive *x){
+    int nchan = x->lsl_nchan;
+
+    if (!x->myList)
+        x->myList = (t_atom *)lslpd_getbytes(nchan * sizeof(t_atom));
+    if (!x->select_runs)
+        x->select_runs = (int *)lslpd_getbytes(2 * nchan * sizeof(int));
+    lslreceive_select(x);
+    if (x->array_prefix && !x->array_names)
+        lslreceive_alloc_arrays(x);
+    if (x->reduce)
+        lslreceive_alloc_reduce(x);
+}
+
+static void lslreceive_free_output(t_lslreceive *x){
+    if (x->myList)
+        lslpd_freebytes(x->myList, x->lsl_nchan * sizeof(t_atom));
+    if (x->select_runs)
+        lslpd_freebytes(x->select_runs, 2 * x->lsl_nchan * sizeof(int));
+    if (x->select_spec)
+        lslpd_freebytes(x->select_spec, x->select_nspec * sizeof(t_atom));
+}
+
+// create the inlet for a resolved stream and everything sized after it
+static int lslreceive_attach(t_lslreceive *x, lsl_streaminfo info){
+    int nchan = lsl_get_channel_count(info);
+
+    if (nchan != x->lsl_nchan) {
+        if (nchan < 1) {
+            post("ERROR: Stream '%s' has %d channels, which is not supported", x->lsl_stream_name, nchan);
+            return 0;
+        }
+        post("Warning: Stream '%s' has %d channels, not %d; using the stream's count.",
+            x->lsl_stream_name, nchan, x->lsl_nchan);
+        x->lsl_nchan = nchan;
+    }
+    x->lsl_inlet = lsl_create_inlet(info, x->max_buffer, x->max_chunk, 1);
+    if (!x->lsl_inlet)
+        return 0;
+    // let liblsl correct and smooth the time stamps; only one thread ever pulls
+    // from the inlet, so proc_threadsafe isn't needed
+    if (x->postprocessing && lsl_set_postprocessing(x->lsl_inlet, x->postprocessing))
+        post("Warning: could not enable time stamp post-processing");
+    if (x->halftime > 0 && lsl_smoothing_halftime(x->lsl_inlet, (float)x->halftime))
+        post("Warning: could not set the smoothing half-time");
+    x->lsl_info = info;
+    x->nominal_rate = x->arrival_rate = lsl_get_nominal_srate(info);
+    x->max_per_tick = x->pending_max_per_tick;
+    lslreceive_alloc_chunk(x);
+    if (x->filter_nspec)
+        x->filter = lslpd_filter_new(x->filter_nspec, x->filter_spec, nchan, x->nominal_rate, x, "lslreceive");
+    for (t_lslreceive *m = x; m; m = m->share_next) {
+        m->lsl_nchan = nchan;
+        lslreceive_alloc_output(m);
+    }
+
+    if (x->threaded) {
+        size_t framebytes = sizeof(double) + x->lsl_nchan * x->format->value_bytes;
+        framebytes = (framebytes + sizeof(double) - 1) & ~(sizeof(double) - 1);
+        if (lslpd_ring_init(&x->ring, framebytes, (size_t)RING_TICKS * x->max_per_tick) &&
+            lslreceive_start_worker(x)) {
+            x->worker_running = 1;
+        } else {
+            post("Warning: could not start the receive thread, polling from Pd instead.");
+            lslpd_ring_free(&x->ring);
+            x->threaded = 0;
+        }
+    }
+    return 1;
+}
+
+static void lslreceive_resolve(t_lslreceive *x){
+    lsl_streaminfo info;
+
+    if (!x->resolver || !(info = lslpd_resolver_match(x->resolver, x->lsl_stream_type)))
+        return;
+    if (!lslreceive_attach(x, info)) {
+        lsl_destroy_streaminfo(info);
+        return;
+    }
+    lsl_destroy_continuous_resolver(x->resolver);
+    x->resolver = NULL;
+    post("Connected to stream '%s'.", x->lsl_stream_name);
+    for (t_lslreceive *m = x; m; m = x->share_iter) {
+        x->share_iter = m->share_next;
+        lslreceive_setstatus(m, STATUS_CONNECTED);
+    }
+}
+
+// receive thread: block in liblsl until data arrives, then move it into the ring
+static void *lslreceive_worker(void *arg){
+    t_lslreceive *x = (t_lslreceive *)arg;
+    size_t samplebytes = x->lsl_nchan * x->format->value_bytes;
+    char *values = (char *)x->chunk_data;
+
+    while (!__atomic_load_n(&x->worker_quit, __ATOMIC_ACQUIRE)) {
+        size_t limit = lslpd_ring_space(&x->ring);
+        unsigned long n = 0;
+        if (!limit) {
+            // Pd is falling behind; let the backlog wait in the inlet's buffer
+            lslpd_sleep(POLLING_INTERVAL_MS * 0.001);
+            continue;
+        }
+        if (limit > (size_t)x->chunk_frames)
+            limit = x->chunk_frames;
+        // a blocking chunk pull only returns once its buffer is full, so wait
+        // for the first sample alone and then take whatever else is queued
+        if (!lsl_samples_available(x->lsl_inlet)) {
+            n = lslreceive_pull(x, 0, 1, WORKER_TIMEOUT);
+            if (!n)
+                continue;
+        }
+        if (limit > n)
+            n += lslreceive_pull(x, n, limit - n, 0.0);
+        for (unsigned long i = 0; i < n; ) {
+            size_t frames;
+            char *frame = (char *)lslpd_ring_writeptr(&x->ring, &frames);
+            if (frames > n - i)
+                frames = n - i;
+            for (size_t j = 0; j < frames; ++j, ++i, frame += x->ring.framebytes) {
+                *(double *)frame = x->chunk_timestamps[i];
+                memcpy(frame + sizeof(double), values + i * samplebytes, samplebytes);
+            }
+            lslpd_ring_commit(&x->ring, frames);
+        }
+    }
+    return NULL;
+}
+
+// add an instance to the shared poller and service it right away
+static void lslreceive_register(t_lslreceive *x){
+    t_lslreceive_poller *p = &lslreceive_poller;
+
+    if (!p->clock) {
+        p->clock = clock_new(p, (t_method)lslreceive_poll);
+        p->epoch = clock_getlogicaltime();
+    }
+    x->poll_next = p->list;
+    p->list = x;
+    x->poll_interval = LSLPD_RESOLVE_INTERVAL_MS;
+    x->poll_due = clock_gettimesince(p->epoch);
+    clock_delay(p->clock, 0);
+}
+
+static void lslreceive_unregister(t_lslreceive *x){
+    t_lslreceive_poller *p = &lslreceive_poller;
+    t_lslreceive **link;
+
+    for (link = &p->list; *link; link = &(*link)->poll_next) {
+        if (*link == x) {
+            *link = x->poll_next;
+            break;
+        }
+    }
+    // we may be freed from inside another instance's outlet during a pass
+    if (p->next == x)
+        p->next = x->poll_next;
+    if (!p->list)
+        clock_unset(p->clock);
+}
+
+// the same filter description, atom by atom
+static int lslreceive_same_filter(t_lslreceive *a, t_lslreceive *b){
+    if (a->filter_nspec != b->filter_nspec)
+        return 0;
+    for (int i = 0; i < a->filter_nspec; ++i) {
+        t_atom *u = a->filter_spec + i, *v = b->filter_spec + i;
+        if (u->a_type != v->a_type || (u->a_type == A_FLOAT ? u->a_w.w_float != v->a_w.w_float :
+            u->a_w.w_symbol != v->a_w.w_symbol))
+            return 0;
+    }
+    return 1;
+}
+
+// instances share an inlet when they would create the same one (and filter it
+// the same way)
+static int lslreceive_shares(t_lslreceive *a, t_lslreceive *b){
+    return lslreceive_same_filter(a, b) && !strcmp(a->lsl_stream_name, b->lsl_stream_name) && !strcmp(a->lsl_stream_type, b->lsl_stream_type) &&
+        a->format == b->format && a->postprocessing == b->postprocessing && a->halftime == b->halftime &&
+        a->max_buffer == b->max_buffer && a->max_chunk == b->max_chunk && a->threaded == b->threaded &&
+        a->latest == b->latest;
+}
+
+// the leader of a group this instance can join (leaders are the instances the
+// poller services), or NULL
+static t_lslreceive *lslreceive_find_leader(t_lslreceive *x){
+    for (t_lslreceive *l = lslreceive_poller.list; l; l = l->poll_next)
+        if (lslreceive_shares(x, l))
+            return l;
+    return NULL;
+}
+
+static void lslreceive_join(t_lslreceive *x, t_lslreceive *leader){
+    t_lslreceive **link = &leader->share_next;
+
+    while (*link)
+        link = &(*link)->share_next;
+    *link = x;
+    x->share_leader = leader;
+    if (leader->lsl_inlet) {
+        x->lsl_nchan = leader->lsl_nchan;
+        lslreceive_alloc_output(x);
+    }
+}
+
+static void lslreceive_leave(t_lslreceive *x){
+    t_lslreceive *leader = x->share_leader, **link;
+
+    for (link = &leader->share_next; *link; link = &(*link)->share_next) {
+        if (*link == x) {
+            *link = x->share_next;
+            break;
+        }
+    }
+    // we may be freed from inside our own outlet while the leader hands out samples
+    if (leader->share_iter == x)
+        leader->share_iter = x->share_next;
+}
+
+// the leader is going away: the next instance in its group takes over the
+// inlet, its buffers and the receive thread, so the others don't reconnect
+static void lslreceive_handoff(t_lslreceive *x){
+    t_lslreceive *next = x->share_next;
+
+    if (x->worker_running) {
+        __atomic_store_n(&x->worker_quit, 1, __ATOMIC_RELEASE);
+        pthread_join(x->worker, NULL);
+        x->worker_running = 0;
+    }
+    next->share_leader = NULL;
+    for (t_lslreceive *m = next->share_next; m; m = m->share_next)
+        m->share_leader = next;
+    next->share_iter = x->share_iter;
+    next->resolver = x->resolver;
+    next->lsl_inlet = x->lsl_inlet;
+    next->lsl_info = x->lsl_info;
+    next->described = x->described;
+    next->describer = x->describer;
+    next->describe_attempts = x->describe_attempts;
+    next->lsl_errcode = x->lsl_errcode;
+    next->nominal_rate = x->nominal_rate;
+    next->arrival_rate = x->arrival_rate;
+    next->max_per_tick = x->max_per_tick;
+    next->pending_max_per_tick = x->pending_max_per_tick;
+    next->chunk_frames = x->chunk_frames;
+    next->chunk_data = x->chunk_data;
+    next->chunk_timestamps = x->chunk_timestamps;
+    next->received = x->received;
+    next->threaded = x->threaded;
+    next->ring = x->ring;
+    next->filter = x->filter;
+    next->filter_pending = x->filter_pending;
+    x->resolver = NULL;
+    x->lsl_inlet = NULL;
+    x->lsl_info = NULL;
+    x->describer = NULL;
+    x->chunk_data = NULL;
+    x->chunk_timestamps = NULL;
+    x->share_next = NULL;
+    x->filter = x->filter_pending = NULL;
+    memset(&x->ring, 0, sizeof(x->ring));
+
+    if (next->threaded && next->lsl_inlet) {
+        if (lslreceive_start_worker(next)) {
+            next->worker_running = 1;
+        } else {
+            post("Warning: could not start the receive thread, polling from Pd instead.");
+            while (lslpd_ring_count(&next->ring)) {
+                size_t frames;
+                char *frame = (char *)lslpd_ring_readptr(&next->ring, &frames);
+                lslreceive_drop(next, frame + sizeof(double), next->ring.framebytes, frames);
+                lslpd_ring_consume(&next->ring, frames);
+            }
+            lslpd_ring_free(&next->ring);
+            next->threaded = 0;
+        }
+    }
+    lslreceive_register(next);
+}
+
+// service every instance that is due, then sleep until the earliest next one
+static void lslreceive_poll(t_lslreceive_poller *p){
+    double now = clock_gettimesince(p->epoch);
+    double next = -1;
+    t_lslreceive *x;
+
+    for (x = p->list; x; x = p->next) {
+        p->next = x->poll_next;
+        if (x->poll_due <= now + POLL_SLACK_MS)
+            lslreceive_getSample(x, now);
+    }
+    p->next = NULL;
+
+    for (x = p->list; x; x = x->poll_next)
+        if (next < 0 || x->poll_due < next)
+            next = x->poll_due;
+    if (next >= 0)
+        clock_delay(p->clock, next > now ? next - now : 0);
+}
+
+// choose when to look at the stream again after a poll that found n samples:
+// back off while it stays quiet, tighten to the observed arrival rate under load
+static void lslreceive_adapt(t_lslreceive *x, size_t n, double now){
+    double interval = x->poll_interval;
+
+    if (n >= (size_t)x->max_per_tick) {
+        // backlog: come back as soon as possible
+        interval = POLLING_INTERVAL_MS;
+    } else if (n) {
+        if (x->nominal_rate > 0) {
+            double elapsed = now - x->poll_last_data;
+            if (elapsed > 0)
+                x->arrival_rate += RATE_SMOOTHING * (n * 1000.0 / elapsed - x->arrival_rate);
+            interval = x->arrival_rate > 0 ? 1000.0 / x->arrival_rate : POLLING_INTERVAL_MS;
+        } else {
+            // irregular streams tend to send bursts of markers
+            interval = POLLING_INTERVAL_MS;
+        }
+        x->poll_last_data = now;
+    } else {
+        interval *= 2;
+    }
+    if (interval < POLLING_INTERVAL_MS)
+        interval = POLLING_INTERVAL_MS;
+    if (interval > MAX_POLL_INTERVAL_MS)
+        interval = MAX_POLL_INTERVAL_MS;
+    x->poll_interval = interval;
+    x->poll_due = now + interval;
+}
+
+// hand n samples ('stride' bytes apart, their time stamps 'stampstride' bytes
+// apart) to every instance sharing the inlet, each taking its own channels,
+// then release them
+static void lslreceive_deliver(t_lslreceive *x, char *values, size_t stride, const char *stamps,
+    size_t stampstride, size_t n){
+    t_lslreceive *m;
+
+    if (!n)
+        return;
+    for (m = x; m; m = x->share_iter) {
+        x->share_iter = m->share_next;
+        if (m->select_waiting)
+            continue;
+        if (m->array_names) {
+            lslreceive_write_arrays(m, values, stride, n, *(const double *)(stamps + (n - 1) * stampstride));
+        } else {
+            for (size_t i = 0; i < n; ++i)
+                m->output(m, *(const double *)(stamps + i * stampstride), values + i * stride);
+        }
+        m->emitted += n;
+    }
+    lslreceive_drop(x, values, stride, n);
+}
+
+void lslreceive_getSample(t_lslreceive *x, double now){
+    size_t emitted = 0;
+    double start;
+    t_lslreceive *m;
+    int lost;
+
+    if (!x->lsl_inlet) {
+        lslreceive_resolve(x);
+        x->poll_interval = POLLING_INTERVAL_MS;
+        x->poll_last_data = now;
+        x->poll_due = now + (x->lsl_inlet ? POLLING_INTERVAL_MS : LSLPD_RESOLVE_INTERVAL_MS);
+        return;
+    }
+
+    start = lsl_local_clock();
+    if (x->describer && __atomic_load_n(&x->describer->done, __ATOMIC_ACQUIRE))
+        lslreceive_described(x);
+    // the next poll is scheduled before emitting, since the outlets may run arbitrary code
+    if (x->threaded) {
+        // the receive thread did the pulling; just emit what it queued
+        size_t todo = lslpd_ring_count(&x->ring);
+        // the poll interval follows what arrived, even if most of it is dropped
+        lslreceive_adapt(x, todo < (size_t)x->pending_max_per_tick ? todo : (size_t)x->pending_max_per_tick, now);
+        if (x->latest && todo > 1) {
+            // drop all but the newest sample queued
+            for (size_t skip = todo - 1; skip; ) {
+                size_t frames;
+                char *frame = (char *)lslpd_ring_readptr(&x->ring, &frames);
+                if (frames > skip)
+                    frames = skip;
+                lslreceive_drop(x, frame + sizeof(double), x->ring.framebytes, frames);
+                lslpd_ring_consume(&x->ring, frames);
+                skip -= frames;
+            }
+            todo = 1;
+        }
+        if (todo > (size_t)x->pending_max_per_tick)
+            todo = x->pending_max_per_tick;
+        while (todo) {
+            size_t frames;
+            char *frame = (char *)lslpd_ring_readptr(&x->ring, &frames);
+            if (frames > todo)
+                frames = todo;
+            lslreceive_deliver(x, frame + sizeof(double), x->ring.framebytes, frame, x->ring.framebytes, frames);
+            lslpd_ring_consume(&x->ring, frames);
+            todo -= frames;
+            emitted += frames;
+        }
+    } else {
+        unsigned long nsamples = 0, pulled = 0;
+        size_t samplebytes = x->lsl_nchan * x->format->value_bytes;
+        char *values;
+
+        if (x->pending_max_per_tick != x->max_per_tick) {
+            lslreceive_free_chunk(x);
+            x->max_per_tick = x->pending_max_per_tick;
+            lslreceive_alloc_chunk(x);
+        }
+        // checking the queue is much cheaper than a pull; still pull once the
+        // poll has fully backed off, which is how a lost stream gets noticed
+        if (lsl_samples_available(x->lsl_inlet) || x->poll_interval >= MAX_POLL_INTERVAL_MS) {
+            // drain up to max_per_tick samples in one library call; anything beyond
+            // that stays buffered in the inlet until the next poll
+            nsamples = pulled = lslreceive_pull(x, 0, x->max_per_tick, 0.0);
+            if (x->latest)
+                nsamples = lslreceive_skip(x, nsamples);
+        }
+        lslreceive_adapt(x, pulled, now);
+        values = (char *)x->chunk_data;
+        lslreceive_deliver(x, values, samplebytes, (char *)x->chunk_timestamps, sizeof(double), nsamples);
+        emitted = nsamples;
+    }
+
+    // per-poll reductions go out now; liblsl keeps trying to recover a lost
+    // stream, so report when data flows again
+    lost = __atomic_load_n(&x->lsl_errcode, __ATOMIC_RELAXED) == lsl_lost_error;
+    for (m = x; m; m = x->share_iter) {
+        x->share_iter = m->share_next;
+        if (m->reduce && !m->reduce_every && m->reduce_count)
+            lslreceive_reduce_flush(m);
+        if (lost)
+            lslreceive_setstatus(m, STATUS_LOST);
+        else if (emitted)
+            lslreceive_setstatus(m, STATUS_CONNECTED);
+    }
+    lslpd_timing_add(&x->polltime, lsl_local_clock() - start);
+}
+
+// report the statistics on the stats outlet (or the console without one):
+// "rate", "received", "emitted", "backlog", "lost", "recovered" and the poll
+// timing as "polltime <min> <mean> <max>" in microseconds plus "pollhist"
+static void lslreceive_stats_report(t_lslreceive *x){
+    // reception happens in the leader of instances sharing an inlet
+    t_lslreceive *src = x->share_leader ? x->share_leader : x;
+    unsigned long received = __atomic_load_n(&src->received, __ATOMIC_RELAXED);
+    double elapsed = clock_gettimesince(x->stats_since) * 0.001;
+    double backlog = 0;
+    t_atom a;
+
+    if (src->lsl_inlet)
+        backlog = lsl_samples_available(src->lsl_inlet);
+    if (src->worker_running)
+        backlog += lslpd_ring_count(&src->ring);
+    SETFLOAT(&a, elapsed > 0 ? (received - x->stats_received) / elapsed : 0);
+    lslpd_stats_out(x->out_stats, "lslreceive", "rate", 1, &a);
+    SETFLOAT(&a, received);
+    lslpd_stats_out(x->out_stats, "lslreceive", "received", 1, &a);
+    SETFLOAT(&a, x->emitted);
+    lslpd_stats_out(x->out_stats, "lslreceive", "emitted", 1, &a);
+    SETFLOAT(&a, backlog);
+    lslpd_stats_out(x->out_stats, "lslreceive", "backlog", 1, &a);
+    SETFLOAT(&a, x->lost_count);
+    lslpd_stats_out(x->out_stats, "lslreceive", "lost", 1, &a);
+    SETFLOAT(&a, x->recovered_count);
+    lslpd_stats_out(x->out_stats, "lslreceive", "recovered", 1, &a);
+    lslpd_timing_out(&src->polltime, x->out_stats, "lslreceive", "polltime", "pollhist");
+
+    x->stats_received = received;
+    x->stats_since = clock_getlogicaltime();
+    if (src == x)
+        lslpd_timing_clear(&x->polltime);
+}
+
+static void lslreceive_stats_tick(t_lslreceive *x){
+    if (x->stats_interval > 0)
+        clock_delay(x->stats_clock, x->stats_interval);
+    lslreceive_stats_report(x);
+}
+
+// 'latest 1' switches to latest-only output, 'latest 0' back to every sample;
+// instances sharing an inlet share this setting
+void lslreceive_latest(t_lslreceive *x, t_floatarg f){
+    t_lslreceive *leader = x->share_leader ? x->share_leader : x;
+    leader->latest = f != 0;
+}
+
+static void lslreceive_set_spec(t_lslreceive *x, int argc, t_atom *argv){
+    if (x->select_spec)
+        lslpd_freebytes(x->select_spec, x->select_nspec * sizeof(t_atom));
+    x->select_spec = NULL;
+    x->select_nspec = argc;
+    if (argc) {
+        x->select_spec = (t_atom *)lslpd_getbytes(argc * sizeof(t_atom));
+        memcpy(x->select_spec, argv, argc * sizeof(t_atom));
+    }
+}
+
+// 'channels <channels...>' picks the channels to output, in the order given:
+// 1-based indices, ranges like 3-8, 'all', or labels from the stream's
+// description; 'channels' alone goes back to all of them
+void lslreceive_channels(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv){
+    lslreceive_set_spec(x, argc, argv);
+    if (!x->select_runs)
+        return;     // not attached yet; resolved once the stream is found
+    lslreceive_select(x);
+    if (x->array_names)
+        lslreceive_arrays(x, x->array_prefix);
+}
+
+static void lslreceive_set_filter(t_lslreceive *x, int argc, t_atom *argv){
+    if (x->filter_spec)
+        lslpd_freebytes(x->filter_spec, x->filter_nspec * sizeof(t_atom));
+    x->filter_spec = NULL;
+    x->filter_nspec = argc;
+    if (argc) {
+        x->filter_spec = (t_atom *)lslpd_getbytes(argc * sizeof(t_atom));
+        memcpy(x->filter_spec, argv, argc * sizeof(t_atom));
+    }
+}
+
+// 'filter <stages...>' replaces the filter of every instance sharing the
+// inlet, keeping none of the old one's state; 'filter off' (or no stages)
+// removes it. The new filter is designed here and swapped in by the thread
+// that pulls, before its next chunk.
+void lslreceive_filter(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv){
+    t_lslreceive *leader = x->share_leader ? x->share_leader : x;
+    t_lslpd_filter *f;
+
+    if (x->lsl_channel_format != cft_float32) {
+        pd_error(x, "lslreceive: only float streams can be filtered");
+        return;
+    }
+    if (argc == 1 && argv->a_type == A_SYMBOL && !strcmp(atom_getsymbol(argv)->s_name, "off"))
+        argc = 0;
+    if (!lslpd_filter_check(argc, argv, x, "lslreceive"))
+        return;
+    if (leader->lsl_inlet) {
+        if (!(f = lslpd_filter_new(argc, argv, leader->lsl_nchan, leader->nominal_rate, x, "lslreceive")))
+            return;
+        lslpd_filter_free(__atomic_exchange_n(&leader->filter_pending, f, __ATOMIC_RELEASE));
+    }
+    // the group's description, which instances created later must match to join
+    for (t_lslreceive *m = leader; m; m = m->share_next)
+        lslreceive_set_filter(m, argc, argv);
+}
+
+// parse "<mode> [<samples>]" into the reduce settings; returns 0 for an unknown mode
+static int lslreceive_reduce_mode(t_lslreceive *x, int argc, t_atom *argv){
+    const char *name = argc ? atom_getsymbol(argv)->s_name : "off";
+    int every = argc > 1 ? atom_getint(argv + 1) : 0;
+
+    for (int i = 0; i < (int)(sizeof(reduce_names) / sizeof(reduce_names[0])); ++i) {
+        if (!strcmp(name, reduce_names[i])) {
+            x->reduce = i;
+            x->reduce_every = every > 0 ? every : 0;
+            x->reduce_count = 0;
+            return 1;
+        }
+    }
+    pd_error(x, "lslreceive: unknown reduce mode '%s' (use off, last, mean, minmax or rms)", name);
+    return 0;
+}
+
+// 'reduce <mode>' outputs one list per poll, 'reduce <mode> <n>' one per n
+// samples; 'reduce off' goes back to a list per sample
+void lslreceive_reduce(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv){
+    if (!x->format->to_float || x->array_prefix) {
+        pd_error(x, "lslreceive: only numeric streams in list mode can be reduced");
+        return;
+    }
+    if (!lslreceive_reduce_mode(x, argc, argv))
+        return;
+    if (x->reduce && x->select_runs)
+        lslreceive_alloc_reduce(x);
+    x->output = x->reduce ? lslreceive_output_reduce : lslreceive_output_numeric;
+}
+
+// 'stats' reports now; 'stats <ms>' sets the interval of periodic reports (0 = off)
+void lslreceive_stats(t_lslreceive *x, t_symbol *s, int argc, t_atom *argv){
+    if (!argc) {
+        lslreceive_stats_report(x);
+        return;
+    }
+    x->stats_interval = atom_getfloat(argv);
+    if (!x->stats_clock)
+        x->stats_clock = clock_new(x, (t_method)lslreceive_stats_tick);
+    if (x->stats_interval > 0)
+        clock_delay(x->stats_clock, x->stats_interval);
+    else
+        clock_unset(x->stats_clock);
 }
 
 
 void lslreceive_free(t_lslreceive* x)
 {
 	/* Do any deallocation needed here. */
-    // clock_unset(x->m_clock);
-    // object_free(x->m_clock);
-    outlet_free(x->out_data);
-    outlet_free(x->out_timestamp);	
-    // lsl_destroy_inlet(x->lsl_inlet);
+    if (x->share_leader)
+        lslreceive_leave(x);
+    else if (x->share_next)
+        lslreceive_handoff(x);
+    if (x->worker_running) {
+        __atomic_store_n(&x->worker_quit, 1, __ATOMIC_RELEASE);
+        pthread_join(x->worker, NULL);
+        // release strings that were queued but never emitted
+        if (x->lsl_channel_format == cft_string) {
+            size_t frames;
+            while ((frames = lslpd_ring_count(&x->ring))) {
+                char *frame = (char *)lslpd_ring_readptr(&x->ring, &frames);
+                for (size_t j = 0; j < frames; ++j, frame += x->ring.framebytes) {
+                    char **values = (char **)(frame + sizeof(double));
+                    for (int k = 0; k < x->lsl_nchan; ++k)
+                        lsl_destroy_string(values[k]);
+                }
+                lslpd_ring_consume(&x->ring, frames);
+            }
+        }
+        lslpd_ring_free(&x->ring);
+    }
+    if (!x->share_leader)
+        lslreceive_unregister(x);
+    if (x->resolver)
+        lsl_destroy_continuous_resolver(x->resolver);
+    if (x->describer)
+        lslreceive_describe_end(x);
+    if (x->lsl_inlet)
+        lsl_destroy_inlet(x->lsl_inlet);
+    if (x->lsl_info)
+        lsl_destroy_streaminfo(x->lsl_info);
+    lslreceive_free_chunk(x);
+    lslreceive_free_output(x);
+    if (x->byteList)
+        lslpd_freebytes(x->byteList, x->byteList_size * sizeof(t_atom));
+    lslpd_strcache_free(&x->cache);
+    lslreceive_free_arrays(x);
+    lslreceive_free_reduce(x);
+    lslpd_filter_free(x->filter);
+    lslpd_filter_free(x->filter_pending);
+    lslreceive_set_filter(x, 0, NULL);
+    if (x->stats_clock)
+        clock_free(x->stats_clock);
 }
 
 // void lslreceive_assist(t_lslreceive* x, void* b, long m, long a, char* s)
@@ -0,0 +1,514 @@
+/*
+* lslreceive~ object for Pure Data.
+*
+* Captures a numeric LSL stream from the network and outputs each channel as
+* an audio signal. Samples are pulled in chunks from the DSP routine into a
+* jitter buffer, so high-rate streams never go through the message system.
+* The rightmost outlet reports "connected" once the stream has been found,
+* "lost" when liblsl loses it and "connected" again when samples flow again.
+*
+* Streams with a nominal rate are resampled to Pd's sample rate. The sender's
+* clock and the audio clock never run at exactly the ratio of their nominal
+* rates, so the resampling step is corrected continuously: a slow controller
+* keeps the jitter buffer at its prefill level, and the clock drift measured
+* by lsl_time_correction() is taken out up front. Irregular streams, and any
+* stream after 'resample 0', are played one sample per Pd sample.
+*
+*/
+
+#include "m_pd.h"      //pd header file
+#include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+
+#define DEFAULT_STREAM_NAME "pd"
+#define DEFAULT_STREAM_TYPE "EEG"
+#define DEFAULT_NCHAN 1
+#define MAX_ARG_LENGTH 50
+#define DEFAULT_BUFFER_FRAMES 8192  //jitter buffer size in samples
+#define DEFAULT_PREFILL_FRAMES 128  //samples to collect before (re)starting output
+#define SCRATCH_FRAMES 256          //non-float streams are pulled this many samples at a time
+#define HALF (LSLPD_RESAMPLE_TAPS / 2)  //interpolation taps on either side of the read position
+#define LEVEL_TIME 1.0              //seconds the fill level is averaged over
+#define KP 0.05                     //step correction per second of excess buffering
+#define KI 0.000625                 //integral gain, KP*KP/4 for a critically damped loop
+#define MAX_CORRECTION 0.01         //the step never moves more than 1% from nominal
+#define CORRECTION_INTERVAL_MS 1000 //how often the clock offset is looked up
+#define DRIFT_MIN_SPAN 30.0         //seconds of clock offsets before a drift is trusted
+#define MAX_UID_LENGTH 64
+
+
+static t_class *lslreceive_tilde_class;
+
+typedef struct _lslreceive_tilde{
+	t_object x_obj;
+
+	/* Stream Attributes */
+	char lsl_stream_name[MAX_ARG_LENGTH]; /* Stream Name */
+	char lsl_stream_type[MAX_ARG_LENGTH];
+    int lsl_nchan;              /* number of channels = number of signal outlets */
+
+	lsl_streaminfo lsl_info;
+	lsl_inlet lsl_inlet;		/* a stream inlet to get samples from */
+    const t_lslpd_format *format;   /* the stream's own channel format */
+    void *scratch;              /* non-float streams: values in their own type, before conversion */
+	int lsl_errcode;			/* error code (lsl_lost_error or timeouts) */
+
+    lsl_continuous_resolver resolver;   /* looks for the stream until it shows up */
+    t_clock *x_clock;           /* polls the resolver */
+    char rejected[MAX_UID_LENGTH];  /* uid of the last stream that didn't fit, reported once */
+    t_outlet *out_status;       /* rightmost outlet: connection status */
+    t_clock *status_clock;      /* reports a change of 'lost' */
+    int lost;                   /* set by the DSP routine while pulls report a lost stream */
+    int reported_lost;          /* the state last reported */
+
+    t_lslpd_ring jitter;        /* interleaved float frames waiting to be played */
+    float *lastframe;           /* last frame played, for holding on underrun */
+    t_sample **outvec;          /* signal outlet vectors, set in the dsp method */
+    int hold;                   /* on underrun: 1 = hold last value, 0 = output zeros */
+    int prefill;                /* frames to collect before output (re)starts */
+    int running;                /* 0 while (re)filling the jitter buffer */
+    int max_buffer;             /* liblsl buffer in seconds, behind the jitter buffer */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = sender's choice */
+
+    int resample;               /* play regular streams at their own rate (default 1) */
+    double nominal_rate;        /* the stream's rate, 0 for irregular streams */
+    double sr;                  /* Pd's sample rate, set in the dsp method */
+    t_lslpd_resampler interp;   /* interpolation kernel for nominal_rate / sr */
+    double pos;                 /* read position past the ring's tail, in stream samples */
+    double level;               /* averaged number of stream samples ahead of pos */
+    double integral;            /* integral term of the fill level controller */
+    double drift;               /* relative rate at which the sender's clock falls behind ours */
+    double drift_since;         /* local time of the first clock offset, 0 = none yet */
+    double drift_offset;        /* and the offset itself */
+    t_clock *drift_clock;       /* looks up the clock offset */
+
+} t_lslreceive_tilde;
+
+
+
+void *lslreceive_tilde_new(t_symbol* s, long argc, t_atom* argv);
+void lslreceive_tilde_free(t_lslreceive_tilde *x);
+void lslreceive_tilde_dsp(t_lslreceive_tilde *x, t_signal **sp);
+t_int *lslreceive_tilde_perform(t_int *w);
+void lslreceive_tilde_hold(t_lslreceive_tilde *x, t_floatarg f);
+void lslreceive_tilde_prefill(t_lslreceive_tilde *x, t_floatarg f);
+void lslreceive_tilde_resample(t_lslreceive_tilde *x, t_floatarg f);
+void lslreceive_tilde_correct(t_lslreceive_tilde *x);
+void lslreceive_tilde_resolve(t_lslreceive_tilde *x);
+void lslreceive_tilde_status(t_lslreceive_tilde *x);
+
+
+
+void *lslreceive_tilde_new(t_symbol* s, long argc, t_atom* argv){
+    t_lslreceive_tilde *x = (t_lslreceive_tilde *)pd_new(lslreceive_tilde_class);
+    int buffer_frames = DEFAULT_BUFFER_FRAMES;
+
+    x->hold = 0;
+    x->prefill = DEFAULT_PREFILL_FRAMES;
+    x->running = 0;
+    x->max_buffer = LSLPD_MAX_BUFFER;
+    x->max_chunk = LSL_NO_PREFERENCE;
+    x->resample = 1;
+
+    /* Flags (-hold, -buffer <samples>, -prefill <samples>, -maxbuffer <seconds>,
+       -chunk <samples>, -noresample) may follow the stream arguments */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-hold")) {
+            x->hold = 1;
+        } else if (!strcmp(flag, "-buffer") && i + 1 < argc) {
+            buffer_frames = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-prefill") && i + 1 < argc) {
+            x->prefill = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-noresample")) {
+            x->resample = 0;
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    argc = npos;
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+    if (x->max_chunk < 0)
+        x->max_chunk = LSL_NO_PREFERENCE;
+
+    /*Stream name*/
+    if (argc>=1 && argv[0].a_type==A_SYMBOL){
+    	strncpy(x->lsl_stream_name,atom_getsymbol(&argv[0])->s_name,MAX_ARG_LENGTH);
+    }else{
+        strncpy(x->lsl_stream_name, DEFAULT_STREAM_NAME, MAX_ARG_LENGTH);
+        post(" Using default stream name (%s)",x->lsl_stream_name);
+    }
+    /* Stream type */
+    if (argc>=2 && argv[1].a_type==A_SYMBOL){
+        strncpy(x->lsl_stream_type,atom_getsymbol(&argv[1])->s_name, MAX_ARG_LENGTH);
+    } else {
+        strncpy(x->lsl_stream_type, DEFAULT_STREAM_TYPE, MAX_ARG_LENGTH);
+        post(" Using default stream type (%s)",x->lsl_stream_type);
+    }
+    /* Number of Channels */
+    if (argc>=3 && argv[2].a_type==A_FLOAT) {
+        x->lsl_nchan = atom_getint(&argv[2]);
+        if (x->lsl_nchan < 1) {
+            x->lsl_nchan = 1;
+            post("Warning: Must specify at least one channel. Defaulting to one channel.");
+        }
+    } else {
+        post(" Using default number of channels (%d).",DEFAULT_NCHAN);
+        x->lsl_nchan = DEFAULT_NCHAN;
+    }
+    if (buffer_frames < 64)
+        buffer_frames = 64;
+    if (x->prefill < 0)
+        x->prefill = 0;
+
+    // the free routine releases whatever was allocated before a failure
+    x->lastframe = (float *)lslpd_getbytes(x->lsl_nchan * sizeof(float));
+    x->outvec = (t_sample **)lslpd_getbytes(x->lsl_nchan * sizeof(t_sample *));
+    if (!lslpd_ring_init(&x->jitter, x->lsl_nchan * sizeof(float), buffer_frames)
+            || !lslpd_resampler_init(&x->interp)) {
+        pd_error(x, "lslreceive~: out of memory");
+        pd_free((t_pd *)x);
+        return NULL;
+    }
+
+    for (int k = 0; k < x->lsl_nchan; ++k)
+        outlet_new(&x->x_obj, &s_signal);
+    x->out_status = outlet_new(&x->x_obj, &s_symbol);
+
+    post("LSL INFO:");
+    post("Stream Name: %s", x->lsl_stream_name);
+    post("Stream Type: %s", x->lsl_stream_type);
+    post("Number of Channels %d", x->lsl_nchan);
+    post("Listening for stream...");
+
+    // outputs silence until the resolver finds the stream
+    x->resolver = lslpd_resolver_new(x->lsl_stream_name);
+    if (!x->resolver)
+        post("Problem creating the stream resolver. No stream will be found.");
+    x->x_clock = clock_new((t_object *)x, (t_method)lslreceive_tilde_resolve);
+    x->drift_clock = clock_new((t_object *)x, (t_method)lslreceive_tilde_correct);
+    x->status_clock = clock_new((t_object *)x, (t_method)lslreceive_tilde_status);
+    clock_delay(x->x_clock, 0);
+
+    return (void *)x;
+}
+
+
+void lslreceive_tilde_setup(void) {
+  lslreceive_tilde_class = class_new(gensym("lslreceive~"),
+							    (t_newmethod)lslreceive_tilde_new,
+							    (t_method)lslreceive_tilde_free,
+							    sizeof(t_lslreceive_tilde),
+							    CLASS_DEFAULT,
+							    A_GIMME,
+							   	0);
+  class_addmethod(lslreceive_tilde_class, (t_method)lslreceive_tilde_dsp, gensym("dsp"), A_CANT, 0);
+  class_addmethod(lslreceive_tilde_class, (t_method)lslreceive_tilde_hold, gensym("hold"), A_FLOAT, 0);
+  class_addmethod(lslreceive_tilde_class, (t_method)lslreceive_tilde_prefill, gensym("prefill"), A_FLOAT, 0);
+  class_addmethod(lslreceive_tilde_class, (t_method)lslreceive_tilde_resample, gensym("resample"), A_FLOAT, 0);
+}
+
+
+// (re)design the interpolation kernel once both rates are known
+static void lslreceive_tilde_design(t_lslreceive_tilde *x){
+    if (x->nominal_rate > 0 && x->sr > 0)
+        lslpd_resampler_design(&x->interp, x->nominal_rate / x->sr);
+}
+
+// a matching stream lslreceive~ can't play is reported once, not on every
+// poll; the resolver stays, in case one that fits shows up
+static int lslreceive_tilde_rejected(t_lslreceive_tilde *x, lsl_streaminfo info){
+    const char *uid = lsl_get_uid(info);
+    int seen = !strncmp(x->rejected, uid, MAX_UID_LENGTH - 1);
+
+    strncpy(x->rejected, uid, MAX_UID_LENGTH - 1);
+    lsl_destroy_streaminfo(info);
+    return seen;
+}
+
+void lslreceive_tilde_resolve(t_lslreceive_tilde *x){
+    lsl_streaminfo info;
+
+    if (!x->resolver)
+        return;
+    info = lslpd_resolver_match(x->resolver, x->lsl_stream_type);
+    if (info && lsl_get_channel_count(info) != x->lsl_nchan) {
+        int nchan = lsl_get_channel_count(info);
+        if (!lslreceive_tilde_rejected(x, info))
+            pd_error(x, "lslreceive~: stream '%s' has %d channels but lslreceive~ has %d outlets",
+                x->lsl_stream_name, nchan, x->lsl_nchan);
+        info = NULL;
+    }
+    // samples are pulled in the stream's own format and converted here
+    if (info && (!(x->format = lslpd_format_get(lsl_get_channel_format(info))) || !x->format->to_float)) {
+        if (!lslreceive_tilde_rejected(x, info))
+            pd_error(x, "lslreceive~: stream '%s' is not numeric and can't be played as a signal",
+                x->lsl_stream_name);
+        info = NULL;
+    }
+    if (info && (x->lsl_inlet = lsl_create_inlet(info, x->max_buffer, x->max_chunk, 1))) {
+        x->lsl_info = info;
+        if (x->format->format != cft_float32)
+            x->scratch = lslpd_getbytes(SCRATCH_FRAMES * x->lsl_nchan * x->format->value_bytes);
+        lsl_destroy_continuous_resolver(x->resolver);
+        x->resolver = NULL;
+        x->nominal_rate = lsl_get_nominal_srate(info);
+        if (x->nominal_rate > 0) {
+            lslreceive_tilde_design(x);
+            clock_delay(x->drift_clock, 0);
+        }
+        post("Connected to stream '%s'.", x->lsl_stream_name);
+        outlet_symbol(x->out_status, gensym("connected"));
+        return;
+    }
+    if (info)
+        lsl_destroy_streaminfo(info);
+    clock_delay(x->x_clock, LSLPD_RESOLVE_INTERVAL_MS);
+}
+
+// liblsl keeps trying to recover a lost stream; the DSP routine latches what
+// the pulls say and this reports it outside of DSP
+void lslreceive_tilde_status(t_lslreceive_tilde *x){
+    int lost = __atomic_load_n(&x->lost, __ATOMIC_ACQUIRE);
+
+    if (lost != x->reported_lost) {
+        x->reported_lost = lost;
+        outlet_symbol(x->out_status, gensym(lost ? "lost" : "connected"));
+    }
+}
+
+void lslreceive_tilde_hold(t_lslreceive_tilde *x, t_floatarg f){
+    x->hold = (f != 0);
+}
+
+void lslreceive_tilde_prefill(t_lslreceive_tilde *x, t_floatarg f){
+    int frames = (int)f;
+    if (frames < 0)
+        frames = 0;
+    if ((size_t)frames > x->jitter.capacity)
+        frames = (int)x->jitter.capacity;
+    x->prefill = frames;
+}
+
+void lslreceive_tilde_resample(t_lslreceive_tilde *x, t_floatarg f){
+    x->resample = (f != 0);
+    x->running = 0;     // refill, then start over at the new rate
+}
+
+// the sender's clock offset, looked up without waiting: liblsl measures it in
+// the background, and until the first measurement is in this just tries again.
+// Its slope over the whole connection is the drift between the two clocks.
+void lslreceive_tilde_correct(t_lslreceive_tilde *x){
+    int errcode = 0;
+    double now = lsl_local_clock();
+    double offset = lsl_time_correction(x->lsl_inlet, 0.0, &errcode);
+
+    if (!errcode) {
+        if (!x->drift_since) {
+            x->drift_since = now;
+            x->drift_offset = offset;
+        } else if (now - x->drift_since >= DRIFT_MIN_SPAN) {
+            x->drift = (offset - x->drift_offset) / (now - x->drift_since);
+            if (fabs(x->drift) > MAX_CORRECTION)
+                x->drift = x->drift > 0 ? MAX_CORRECTION : -MAX_CORRECTION;
+        }
+    }
+    clock_delay(x->drift_clock, CORRECTION_INTERVAL_MS);
+}
+
+void lslreceive_tilde_dsp(t_lslreceive_tilde *x, t_signal **sp){
+    for (int k = 0; k < x->lsl_nchan; ++k)
+        x->outvec[k] = sp[k]->s_vec;
+    x->sr = sp[0]->s_sr;
+    lslreceive_tilde_design(x);
+    dsp_add(lslreceive_tilde_perform, 2, x, (t_int)sp[0]->s_n);
+}
+
+// pull up to 'frames' samples into the ring at dest: float streams directly,
+// others through the scratch buffer and the format's converter
+static size_t lslreceive_tilde_pull(t_lslreceive_tilde *x, float *dest, size_t frames){
+    size_t nchan = x->lsl_nchan, got, total = 0;
+
+    if (!x->scratch)
+        return lsl_pull_chunk_f(x->lsl_inlet, dest, NULL, frames * nchan, 0, 0.0, &x->lsl_errcode) / nchan;
+    do {
+        size_t want = frames - total < SCRATCH_FRAMES ? frames - total : SCRATCH_FRAMES;
+        got = x->format->pull_chunk(x->lsl_inlet, x->scratch, NULL, want * nchan, 0, 0.0, &x->lsl_errcode) / nchan;
+        x->format->to_float(dest + total * nchan, x->scratch, got * nchan);
+        total += got;
+        if (got < want)
+            break;
+    } while (total < frames);
+    return total;
+}
+
+// move whatever liblsl has buffered into the jitter buffer; the chunk is pulled
+// straight into the ring storage (at most two pulls when the free space wraps).
+// Returns the number of samples.
+static size_t lslreceive_tilde_fill(t_lslreceive_tilde *x){
+    size_t frames, got, total = 0;
+    float *dest;
+
+    do {
+        dest = (float *)lslpd_ring_writeptr(&x->jitter, &frames);
+        if (!frames) {
+            // overrun: drop the oldest block so latency stays bounded
+            size_t drop = x->jitter.capacity / 4;
+            lslpd_ring_consume(&x->jitter, drop);
+            x->pos = x->pos > drop + HALF - 1 ? x->pos - drop : HALF - 1;
+            dest = (float *)lslpd_ring_writeptr(&x->jitter, &frames);
+        }
+        got = lslreceive_tilde_pull(x, dest, frames);
+        lslpd_ring_commit(&x->jitter, got);
+        total += got;
+    } while (got == frames);
+    return total;
+}
+
+// interpolate up to n output frames at the corrected step; returns how many
+// could be made before the jitter buffer ran dry
+static int lslreceive_tilde_interpolate(t_lslreceive_tilde *x, int n){
+    size_t count = lslpd_ring_count(&x->jitter), used;
+    double target = x->prefill + HALF;      // stream samples to keep ahead of pos
+    double dt = n / x->sr, err, correction, step;
+    const float *taps[LSLPD_RESAMPLE_TAPS];
+    int done = 0;
+
+    // fill level controller: a step a little too large drains the buffer and
+    // one a little too small fills it, so a PI loop on the averaged level finds
+    // the ratio the two clocks actually run at
+    x->level += (count - x->pos - x->level) * (dt < LEVEL_TIME ? dt / LEVEL_TIME : 1);
+    if (x->level > 2 * target + LSLPD_RESAMPLE_TAPS && count - x->pos > target) {
+        // a backlog (e.g. after a network stall) is skipped rather than played late
+        x->pos = count - target;
+        x->level = target;
+    }
+    err = (x->level - target) / x->nominal_rate;
+    x->integral += KI * err * dt;
+    if (fabs(x->integral) > MAX_CORRECTION)
+        x->integral = x->integral > 0 ? MAX_CORRECTION : -MAX_CORRECTION;
+    correction = KP * err + x->integral;
+    if (fabs(correction) > MAX_CORRECTION)
+        correction = correction > 0 ? MAX_CORRECTION : -MAX_CORRECTION;
+    step = x->nominal_rate / x->sr * (1 - x->drift) * (1 + correction);
+
+    for (; done < n; ++done) {
+        size_t i0 = (size_t)x->pos;
+        if (i0 + HALF >= count)
+            break;
+        for (int t = 0; t < LSLPD_RESAMPLE_TAPS; ++t)
+            taps[t] = (const float *)lslpd_ring_peek(&x->jitter, i0 - (HALF - 1) + t);
+        lslpd_resampler_frame(&x->interp, x->lastframe, taps, x->lsl_nchan, x->pos - i0);
+        for (int k = 0; k < x->lsl_nchan; ++k)
+            x->outvec[k][done] = x->lastframe[k];
+        x->pos += step;
+    }
+
+    // let go of the frames no later output needs
+    used = (size_t)x->pos - (HALF - 1);
+    lslpd_ring_consume(&x->jitter, used);
+    x->pos -= used;
+    return done;
+}
+
+t_int *lslreceive_tilde_perform(t_int *w){
+    t_lslreceive_tilde *x = (t_lslreceive_tilde *)(w[1]);
+    int n = (int)(w[2]);
+    int nchan = x->lsl_nchan;
+    int done = 0;
+    int interpolate = x->resample && x->nominal_rate > 0 && x->interp.step > 0;
+
+    if (x->lsl_inlet) {
+        size_t got = lslreceive_tilde_fill(x);
+        int lost = x->lsl_errcode == lsl_lost_error ? 1 : got ? 0 : x->lost;
+        if (lost != x->lost) {
+            __atomic_store_n(&x->lost, lost, __ATOMIC_RELEASE);
+            clock_delay(x->status_clock, 0);
+        }
+    }
+
+    if (!x->running && interpolate) {
+        // start with prefill samples ahead of the read position and the
+        // kernel's history behind it; anything older is dropped
+        size_t count = lslpd_ring_count(&x->jitter), need = x->prefill + LSLPD_RESAMPLE_TAPS - 1;
+        if (need > x->jitter.capacity)
+            need = x->jitter.capacity;
+        if (count >= need) {
+            lslpd_ring_consume(&x->jitter, count - need);
+            x->pos = HALF - 1;
+            x->level = need - x->pos;
+            x->running = 1;
+        }
+    } else if (!x->running && lslpd_ring_count(&x->jitter) >= (size_t)(x->prefill > n ? x->prefill : n)) {
+        x->running = 1;
+    }
+
+    if (x->running && interpolate) {
+        done = lslreceive_tilde_interpolate(x, n);
+        if (done < n)
+            x->running = 0;     // underrun: refill before resuming
+    }
+
+    // deinterleave from the jitter buffer into the outlets
+    while (x->running && !interpolate && done < n) {
+        size_t frames;
+        const float *src = (const float *)lslpd_ring_readptr(&x->jitter, &frames);
+        if (!frames) {
+            x->running = 0;     // underrun: refill before resuming
+            break;
+        }
+        if (frames > (size_t)(n - done))
+            frames = n - done;
+        lslpd_deinterleave(x->outvec, done, src, nchan, frames);
+        memcpy(x->lastframe, src + (frames - 1) * nchan, nchan * sizeof(float));
+        lslpd_ring_consume(&x->jitter, frames);
+        done += frames;
+    }
+
+    // underrun policy for the rest of the block
+    for (int k = 0; k < nchan; ++k) {
+        t_sample *out = x->outvec[k];
+        t_sample fill = x->hold ? x->lastframe[k] : 0;
+        for (int i = done; i < n; ++i)
+            out[i] = fill;
+    }
+
+    return (w+3);
+}
+
+
+void lslreceive_tilde_free(t_lslreceive_tilde *x)
+{
+    // (the clocks are missing if creation failed)
+    if (x->x_clock)
+        clock_free(x->x_clock);
+    if (x->drift_clock)
+        clock_free(x->drift_clock);
+    if (x->status_clock)
+        clock_free(x->status_clock);
+    if (x->resolver)
+        lsl_destroy_continuous_resolver(x->resolver);
+    if (x->lsl_inlet)
+        lsl_destroy_inlet(x->lsl_inlet);
+    if (x->lsl_info)
+        lsl_destroy_streaminfo(x->lsl_info);
+    lslpd_ring_free(&x->jitter);
+    if (x->scratch)
+        lslpd_freebytes(x->scratch, SCRATCH_FRAMES * x->lsl_nchan * x->format->value_bytes);
+    lslpd_freebytes(x->lastframe, x->lsl_nchan * sizeof(float));
+    lslpd_freebytes(x->outvec, x->lsl_nchan * sizeof(t_sample *));
+    lslpd_resampler_free(&x->interp);
+}
@@ -0,0 +1,567 @@
+/*
+* lslrecord object for Pure Data.
+*
+* Records an LSL stream to disk without its samples passing through Pd. The
+* stream is resolved in the background; 'start <file>' creates an inlet and a
+* writer thread that pulls chunks and appends them, with their time stamps
+* and periodic clock offsets, to an XDF file (the format LabRecorder writes)
+* through a large stdio buffer. 'annotate ...' adds a marker, stamped with the
+* current logical time, to a second stream in the same file, and 'stop' lets
+* the writer finish the file in the background.
+*
+* The left outlet reports the number of samples recorded (once a second and
+* when the file is closed), the right one the state: "resolving", "connected",
+* "recording", "stopped" or "error".
+*
+*/
+
+#include "m_pd.h"      //pd header file
+#include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+
+#define DEFAULT_STREAM_NAME "pd"
+#define MAX_ARG_LENGTH 50
+#define CHUNK_FRAMES 1024       //most samples pulled and written at a time
+#define WRITE_BUFFER_BYTES (1 << 20) //stdio buffer of the file, so the disk sees large writes
+#define PULL_TIMEOUT 0.1        //seconds the writer blocks waiting for data
+#define CORRECTION_INTERVAL 5.0 //seconds between clock offset chunks
+#define FULLINFO_TIMEOUT 2.0    //seconds the writer waits for the stream's description
+#define ANNOTATION_LENGTH 1000  //longest annotation in bytes, including the terminator
+#define ANNOTATION_QUEUE 64     //annotations waiting for the writer
+#define REPORT_INTERVAL_MS 1000 //sample count output while recording
+
+/* XDF chunk tags, and the stream ids used in the file */
+enum { XDF_FILEHEADER = 1, XDF_STREAMHEADER = 2, XDF_SAMPLES = 3, XDF_CLOCKOFFSET = 4, XDF_STREAMFOOTER = 6 };
+enum { STREAM_DATA = 1, STREAM_ANNOTATIONS = 2 };
+
+/* states reported on the status outlet */
+enum { STATUS_RESOLVING, STATUS_CONNECTED, STATUS_RECORDING, STATUS_STOPPED, STATUS_ERROR };
+static const char *status_names[] = { "resolving", "connected", "recording", "stopped", "error" };
+
+static t_class *lslrecord_class;
+
+/* what goes into a stream's footer */
+typedef struct _lslrecord_track{
+    unsigned long count;
+    double first, last;
+} t_lslrecord_track;
+
+typedef struct _lslrecord{
+    t_object x_obj;
+
+    char lsl_stream_name[MAX_ARG_LENGTH];
+    char lsl_stream_type[MAX_ARG_LENGTH];  /* empty = any type */
+    lsl_continuous_resolver resolver;   /* looks for the stream until it shows up */
+    lsl_streaminfo info;        /* the stream, once found */
+    const t_lslpd_format *format;   /* its own channel format */
+    int nchan;
+    int max_buffer;             /* liblsl buffer in seconds */
+    int status;
+
+    t_canvas *canvas;           /* relative file names are relative to the patch */
+    t_clock *clock;             /* resolves, then reports while recording */
+    t_lslpd_timebase timebase;  /* annotation stamps: logical time -> LSL time */
+
+    /* recording: set up on the Pd thread by 'start', used by the writer thread
+       until it sets 'done', then released on the Pd thread again */
+    char path[MAXPDSTRING];
+    lsl_inlet inlet;
+    FILE *file;
+    char *file_buffer;          /* WRITE_BUFFER_BYTES for setvbuf */
+    void *chunk_data;           /* interleaved values in the format's C type */
+    double *chunk_timestamps;
+    char *staging;              /* numeric streams: one samples chunk as written */
+    size_t staging_bytes;
+    t_lslpd_ring annotations;   /* frame = double time stamp + ANNOTATION_LENGTH text */
+    t_lslrecord_track tracks[2];    /* data and annotation streams */
+    int worker_running;
+    int worker_quit;
+    int worker_done;            /* set (release) when the file is closed */
+    int worker_error;           /* errno of the first failure, 0 if none */
+    pthread_t worker;
+
+    t_outlet *out_count, *out_status;
+} t_lslrecord;
+
+
+void *lslrecord_new(t_symbol *s, long argc, t_atom *argv);
+void lslrecord_free(t_lslrecord *x);
+void lslrecord_start(t_lslrecord *x, t_symbol *file);
+void lslrecord_stop(t_lslrecord *x);
+void lslrecord_annotate(t_lslrecord *x, t_symbol *s, int argc, t_atom *argv);
+static void lslrecord_tick(t_lslrecord *x);
+static void *lslrecord_worker(void *arg);
+
+
+void *lslrecord_new(t_symbol *s, long argc, t_atom *argv){
+    t_lslrecord *x = (t_lslrecord *)pd_new(lslrecord_class);
+
+    x->max_buffer = LSLPD_MAX_BUFFER;
+
+    /* Stream name and type, then flags (-maxbuffer <seconds>) */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    argc = npos;
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+
+    if (argc >= 1 && argv[0].a_type == A_SYMBOL) {
+        strncpy(x->lsl_stream_name, atom_getsymbol(&argv[0])->s_name, MAX_ARG_LENGTH - 1);
+    } else {
+        strncpy(x->lsl_stream_name, DEFAULT_STREAM_NAME, MAX_ARG_LENGTH - 1);
+        post(" Using default stream name (%s)", x->lsl_stream_name);
+    }
+    if (argc >= 2 && argv[1].a_type == A_SYMBOL)
+        strncpy(x->lsl_stream_type, atom_getsymbol(&argv[1])->s_name, MAX_ARG_LENGTH - 1);
+
+    x->out_count = outlet_new(&x->x_obj, &s_float);     /* Left: samples recorded */
+    x->out_status = outlet_new(&x->x_obj, &s_symbol);   /* Right: state */
+    x->canvas = canvas_getcurrent();
+    x->clock = clock_new(x, (t_method)lslrecord_tick);
+    x->status = STATUS_RESOLVING;
+    x->resolver = lslpd_resolver_new(x->lsl_stream_name);
+    if (!x->resolver)
+        post("Problem creating the stream resolver. No stream will be found.");
+    else
+        clock_delay(x->clock, 0);
+    return (void *)x;
+}
+
+void lslrecord_setup(void) {
+  lslrecord_class = class_new(gensym("lslrecord"),
+                                (t_newmethod)lslrecord_new,
+                                (t_method)lslrecord_free,
+                                sizeof(t_lslrecord),
+                                CLASS_DEFAULT,
+                                A_GIMME,
+                                0);
+
+  class_addmethod(lslrecord_class, (t_method)lslrecord_start, gensym("start"), A_SYMBOL, 0);
+  class_addmethod(lslrecord_class, (t_method)lslrecord_stop, gensym("stop"), 0);
+  class_addmethod(lslrecord_class, (t_method)lslrecord_annotate, gensym("annotate"), A_GIMME, 0);
+}
+
+static void lslrecord_setstatus(t_lslrecord *x, int status){
+    if (status != x->status) {
+        x->status = status;
+        outlet_symbol(x->out_status, gensym(status_names[status]));
+    }
+}
+
+
+/* ==== writer thread ==== */
+
+// XDF is little-endian; header fields are written byte by byte, sample values
+// in host order (which is little-endian on every platform Pd runs on)
+static char *lslrecord_put(char *p, unsigned long long value, int bytes){
+    for (int i = 0; i < bytes; ++i, value >>= 8)
+        *p++ = (char)(value & 0xff);
+    return p;
+}
+
+// a variable-length count: one byte saying how many bytes follow (1, 4 or 8)
+static char *lslrecord_put_count(char *p, unsigned long long value){
+    int bytes = value < 0x100 ? 1 : value <= 0xffffffffULL ? 4 : 8;
+    *p++ = (char)bytes;
+    return lslrecord_put(p, value, bytes);
+}
+
+static size_t lslrecord_count_bytes(unsigned long long value){
+    return 1 + (value < 0x100 ? 1 : value <= 0xffffffffULL ? 4 : 8);
+}
+
+static void lslrecord_write(t_lslrecord *x, const void *data, size_t n){
+    if (n && fwrite(data, 1, n, x->file) != n && !x->worker_error)
+        x->worker_error = errno ? errno : EIO;
+}
+
+// chunk length (covering the tag and 'content' bytes of content), then the tag
+static void lslrecord_chunk(t_lslrecord *x, int tag, size_t content){
+    char head[12], *p = lslrecord_put_count(head, content + 2);
+    p = lslrecord_put(p, tag, 2);
+    lslrecord_write(x, head, p - head);
+}
+
+// a chunk made of a stream id followed by text (stream headers and footers)
+static void lslrecord_xml(t_lslrecord *x, int tag, int id, const char *xml){
+    char head[4];
+    size_t len = strlen(xml);
+    lslrecord_chunk(x, tag, 4 + len);
+    lslrecord_put(head, id, 4);
+    lslrecord_write(x, head, 4);
+    lslrecord_write(x, xml, len);
+}
+
+static void lslrecord_track(t_lslrecord_track *t, const double *stamps, unsigned long n){
+    if (!t->count)
+        t->first = stamps[0];
+    t->last = stamps[n - 1];
+    __atomic_store_n(&t->count, t->count + n, __ATOMIC_RELAXED);    // read by the Pd thread
+}
+
+// numeric samples: the chunk content is assembled in the staging buffer
+static void lslrecord_write_numeric(t_lslrecord *x, unsigned long n){
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+    const char *values = (const char *)x->chunk_data;
+    char *p = x->staging;
+
+    p = lslrecord_put(p, STREAM_DATA, 4);
+    p = lslrecord_put_count(p, n);
+    for (unsigned long i = 0; i < n; ++i, values += samplebytes) {
+        *p++ = 8;               // every sample carries its time stamp
+        memcpy(p, &x->chunk_timestamps[i], 8);
+        memcpy(p + 8, values, samplebytes);
+        p += 8 + samplebytes;
+    }
+    lslrecord_chunk(x, XDF_SAMPLES, p - x->staging);
+    lslrecord_write(x, x->staging, p - x->staging);
+}
+
+// string samples (and annotations): each value is a count and its bytes
+static void lslrecord_write_strings(t_lslrecord *x, int id, unsigned long n, int nchan,
+    const double *stamps, char **values){
+    size_t content = 4 + lslrecord_count_bytes(n);
+    char head[16], *p;
+
+    for (unsigned long i = 0; i < n * nchan; ++i) {
+        size_t len = strlen(values[i]);
+        content += lslrecord_count_bytes(len) + len;
+    }
+    content += n * 9;
+    lslrecord_chunk(x, XDF_SAMPLES, content);
+    p = lslrecord_put(head, id, 4);
+    p = lslrecord_put_count(p, n);
+    lslrecord_write(x, head, p - head);
+    for (unsigned long i = 0; i < n; ++i) {
+        head[0] = 8;
+        memcpy(head + 1, stamps + i, 8);
+        lslrecord_write(x, head, 9);
+        for (int k = 0; k < nchan; ++k) {
+            const char *str = values[i * nchan + k];
+            size_t len = strlen(str);
+            p = lslrecord_put_count(head, len);
+            lslrecord_write(x, head, p - head);
+            lslrecord_write(x, str, len);
+        }
+    }
+}
+
+// pull up to maxframes samples into the chunk buffers from sample 'offset' on
+static unsigned long lslrecord_pull(t_lslrecord *x, unsigned long offset, unsigned long maxframes, double timeout){
+    unsigned long nchan = x->nchan;
+    int errcode = 0;
+
+    return x->format->pull_chunk(x->inlet, (char *)x->chunk_data + offset * nchan * x->format->value_bytes,
+        x->chunk_timestamps + offset, maxframes * nchan, maxframes, timeout, &errcode) / nchan;
+}
+
+static void lslrecord_write_samples(t_lslrecord *x, unsigned long n){
+    if (!n)
+        return;
+    lslrecord_track(&x->tracks[0], x->chunk_timestamps, n);
+    if (x->format->format == cft_string) {
+        char **values = (char **)x->chunk_data;
+        lslrecord_write_strings(x, STREAM_DATA, n, x->nchan, x->chunk_timestamps, values);
+        for (unsigned long i = 0; i < n * x->nchan; ++i)
+            lsl_destroy_string(values[i]);
+    } else {
+        lslrecord_write_numeric(x, n);
+    }
+}
+
+static void lslrecord_write_annotations(t_lslrecord *x){
+    size_t frames;
+
+    while (lslpd_ring_count(&x->annotations)) {
+        char *frame = (char *)lslpd_ring_readptr(&x->annotations, &frames);
+        char *text = frame + sizeof(double);
+        lslrecord_track(&x->tracks[1], (double *)frame, 1);
+        lslrecord_write_strings(x, STREAM_ANNOTATIONS, 1, 1, (double *)frame, &text);
+        lslpd_ring_consume(&x->annotations, 1);
+    }
+}
+
+// the sender's clock offset, so readers can map the time stamps onto ours.
+// liblsl estimates it in the background; asking without a timeout takes the
+// latest estimate, and while there is none yet this chunk is just skipped
+// rather than holding up the samples.
+static void lslrecord_write_offset(t_lslrecord *x){
+    int errcode = 0;
+    double offset = lsl_time_correction(x->inlet, 0.0, &errcode);
+    double now = lsl_local_clock();
+    char content[20], *p;
+
+    if (errcode)
+        return;
+    now -= offset;
+    p = lslrecord_put(content, STREAM_DATA, 4);
+    memcpy(p, &now, 8);
+    memcpy(p + 8, &offset, 8);
+    lslrecord_chunk(x, XDF_CLOCKOFFSET, sizeof(content));
+    lslrecord_write(x, content, sizeof(content));
+}
+
+static void lslrecord_write_footer(t_lslrecord *x, int id){
+    const t_lslrecord_track *t = &x->tracks[id - 1];
+    char xml[256];
+
+    snprintf(xml, sizeof(xml), "<?xml version=\"1.0\"?><info><first_timestamp>%.17g</first_timestamp>"
+        "<last_timestamp>%.17g</last_timestamp><sample_count>%lu</sample_count></info>",
+        t->first, t->last, t->count);
+    lslrecord_xml(x, XDF_STREAMFOOTER, id, xml);
+}
+
+// the file starts with the magic number, the file header and both stream headers.
+// Resolved stream infos carry no <desc> (channel labels, units, ...), so the
+// data stream's header is written from the full info, fetched here as the
+// writer may block; only if that fails from the resolved one.
+static int lslrecord_open(t_lslrecord *x){
+    char name[MAX_ARG_LENGTH + 16], *xml;
+    lsl_streaminfo markers, full;
+    int errcode = 0;
+
+    if (!(x->file = fopen(x->path, "wb"))) {
+        x->worker_error = errno;
+        return 0;
+    }
+    setvbuf(x->file, x->file_buffer, _IOFBF, WRITE_BUFFER_BYTES);
+    lslrecord_write(x, "XDF:", 4);
+    xml = "<?xml version=\"1.0\"?><info><version>1.0</version></info>";
+    lslrecord_chunk(x, XDF_FILEHEADER, strlen(xml));
+    lslrecord_write(x, xml, strlen(xml));
+    full = lsl_get_fullinfo(x->inlet, FULLINFO_TIMEOUT, &errcode);
+    if (full && errcode) {
+        lsl_destroy_streaminfo(full);
+        full = NULL;
+    }
+    if ((xml = lsl_get_xml(full ? full : x->info))) {
+        lslrecord_xml(x, XDF_STREAMHEADER, STREAM_DATA, xml);
+        lsl_destroy_string(xml);
+    }
+    if (full)
+        lsl_destroy_streaminfo(full);
+    snprintf(name, sizeof(name), "%s-annotations", x->lsl_stream_name);
+    if ((markers = lsl_create_streaminfo(name, "Markers", 1, LSL_IRREGULAR_RATE, cft_string, ""))) {
+        if ((xml = lsl_get_xml(markers))) {
+            lslrecord_xml(x, XDF_STREAMHEADER, STREAM_ANNOTATIONS, xml);
+            lsl_destroy_string(xml);
+        }
+        lsl_destroy_streaminfo(markers);
+    }
+    return 1;
+}
+
+// writer thread: wait for data in liblsl and append it to the file until stopped
+static void *lslrecord_worker(void *arg){
+    t_lslrecord *x = (t_lslrecord *)arg;
+    double next_correction = 0;
+    unsigned long n;
+
+    if (!lslrecord_open(x)) {
+        __atomic_store_n(&x->worker_done, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    while (!__atomic_load_n(&x->worker_quit, __ATOMIC_ACQUIRE) && !x->worker_error) {
+        if (lsl_local_clock() >= next_correction) {
+            lslrecord_write_offset(x);
+            next_correction = lsl_local_clock() + CORRECTION_INTERVAL;
+        }
+        lslrecord_write_annotations(x);
+        // a blocking chunk pull only returns once its buffer is full, so wait
+        // for the first sample alone and then take whatever else is queued
+        n = 0;
+        if (!lsl_samples_available(x->inlet) && !(n = lslrecord_pull(x, 0, 1, PULL_TIMEOUT)))
+            continue;
+        n += lslrecord_pull(x, n, CHUNK_FRAMES - n, 0.0);
+        lslrecord_write_samples(x, n);
+    }
+    // what arrived before the stop, the last offset and annotations, the footers
+    while (!x->worker_error && (n = lslrecord_pull(x, 0, CHUNK_FRAMES, 0.0)))
+        lslrecord_write_samples(x, n);
+    lslrecord_write_offset(x);
+    lslrecord_write_annotations(x);
+    lslrecord_write_footer(x, STREAM_DATA);
+    lslrecord_write_footer(x, STREAM_ANNOTATIONS);
+    if (fclose(x->file) && !x->worker_error)
+        x->worker_error = errno ? errno : EIO;
+    x->file = NULL;
+    __atomic_store_n(&x->worker_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+
+/* ==== Pd side ==== */
+
+static void lslrecord_alloc(t_lslrecord *x){
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+
+    x->file_buffer = (char *)lslpd_getbytes(WRITE_BUFFER_BYTES);
+    x->chunk_data = lslpd_getbytes(CHUNK_FRAMES * samplebytes);
+    x->chunk_timestamps = (double *)lslpd_getbytes(CHUNK_FRAMES * sizeof(double));
+    if (x->format->format != cft_string) {
+        x->staging_bytes = 16 + CHUNK_FRAMES * (9 + samplebytes);
+        x->staging = (char *)lslpd_getbytes(x->staging_bytes);
+    }
+}
+
+static void lslrecord_release(t_lslrecord *x){
+    size_t samplebytes = x->nchan * x->format->value_bytes;
+
+    lslpd_freebytes(x->file_buffer, WRITE_BUFFER_BYTES);
+    lslpd_freebytes(x->chunk_data, CHUNK_FRAMES * samplebytes);
+    lslpd_freebytes(x->chunk_timestamps, CHUNK_FRAMES * sizeof(double));
+    if (x->staging)
+        lslpd_freebytes(x->staging, x->staging_bytes);
+    x->file_buffer = x->staging = NULL;
+    x->chunk_data = NULL;
+    x->chunk_timestamps = NULL;
+    lslpd_ring_free(&x->annotations);
+    lsl_destroy_inlet(x->inlet);
+    x->inlet = NULL;
+}
+
+// the writer has closed the file: clean up and report
+static void lslrecord_finish(t_lslrecord *x){
+    pthread_join(x->worker, NULL);
+    x->worker_running = 0;
+    lslrecord_release(x);
+    outlet_float(x->out_count, x->tracks[0].count);
+    if (x->worker_error) {
+        pd_error(x, "lslrecord: %s: %s", x->path, strerror(x->worker_error));
+        lslrecord_setstatus(x, STATUS_ERROR);
+    } else {
+        post("lslrecord: wrote %lu samples to %s", x->tracks[0].count, x->path);
+        lslrecord_setstatus(x, STATUS_STOPPED);
+    }
+}
+
+static void lslrecord_tick(t_lslrecord *x){
+    if (x->resolver) {
+        lsl_streaminfo info = lslpd_resolver_match(x->resolver, x->lsl_stream_type);
+        if (info && !lslpd_format_get(lsl_get_channel_format(info))) {
+            post("ERROR: Stream '%s' has an unsupported format", x->lsl_stream_name);
+            lsl_destroy_streaminfo(info);
+            info = NULL;
+        }
+        if (!info) {
+            clock_delay(x->clock, LSLPD_RESOLVE_INTERVAL_MS);
+            return;
+        }
+        x->info = info;
+        x->format = lslpd_format_get(lsl_get_channel_format(info));
+        x->nchan = lsl_get_channel_count(info);
+        lsl_destroy_continuous_resolver(x->resolver);
+        x->resolver = NULL;
+        post("Found stream '%s'.", x->lsl_stream_name);
+        lslrecord_setstatus(x, STATUS_CONNECTED);
+        return;
+    }
+    if (!x->worker_running)
+        return;
+    if (__atomic_load_n(&x->worker_done, __ATOMIC_ACQUIRE)) {
+        lslrecord_finish(x);
+        return;
+    }
+    outlet_float(x->out_count, __atomic_load_n(&x->tracks[0].count, __ATOMIC_RELAXED));
+    clock_delay(x->clock, __atomic_load_n(&x->worker_quit, __ATOMIC_RELAXED) ?
+        LSLPD_RESOLVE_INTERVAL_MS : REPORT_INTERVAL_MS);
+}
+
+// 'start <file>': record into a new file (relative to the patch's directory)
+void lslrecord_start(t_lslrecord *x, t_symbol *file){
+    if (!x->info) {
+        pd_error(x, "lslrecord: stream '%s' hasn't been found yet", x->lsl_stream_name);
+        return;
+    }
+    if (x->worker_running) {
+        pd_error(x, "lslrecord: %s", x->worker_quit ? "still closing the last file" : "already recording");
+        return;
+    }
+    canvas_makefilename(x->canvas, file->s_name, x->path, MAXPDSTRING);
+    if (!(x->inlet = lsl_create_inlet(x->info, x->max_buffer, LSL_NO_PREFERENCE, 1))) {
+        pd_error(x, "lslrecord: could not create an inlet for '%s'", x->lsl_stream_name);
+        return;
+    }
+    if (!lslpd_ring_init(&x->annotations, sizeof(double) + ANNOTATION_LENGTH, ANNOTATION_QUEUE)) {
+        lsl_destroy_inlet(x->inlet);
+        x->inlet = NULL;
+        pd_error(x, "lslrecord: out of memory");
+        return;
+    }
+    lslrecord_alloc(x);
+    memset(x->tracks, 0, sizeof(x->tracks));
+    x->worker_quit = x->worker_done = x->worker_error = 0;
+    if (pthread_create(&x->worker, NULL, lslrecord_worker, x)) {
+        lslrecord_release(x);
+        pd_error(x, "lslrecord: could not start the writer thread");
+        return;
+    }
+    x->worker_running = 1;
+    lslpd_timebase_sync(&x->timebase);
+    lslrecord_setstatus(x, STATUS_RECORDING);
+    clock_delay(x->clock, REPORT_INTERVAL_MS);
+}
+
+// the writer finishes the file on its own; the clock picks up the result
+void lslrecord_stop(t_lslrecord *x){
+    if (!x->worker_running || x->worker_quit)
+        return;
+    __atomic_store_n(&x->worker_quit, 1, __ATOMIC_RELEASE);
+    clock_delay(x->clock, 0);
+}
+
+// 'annotate <anything>': a marker in the file's annotation stream
+void lslrecord_annotate(t_lslrecord *x, t_symbol *s, int argc, t_atom *argv){
+    char *frame, *text;
+    size_t frames, len = 0;
+    double now;
+
+    if (!x->worker_running || x->worker_quit) {
+        pd_error(x, "lslrecord: not recording");
+        return;
+    }
+    if (!lslpd_ring_space(&x->annotations)) {
+        pd_error(x, "lslrecord: too many annotations at once; dropped one");
+        return;
+    }
+    frame = (char *)lslpd_ring_writeptr(&x->annotations, &frames);
+    text = frame + sizeof(double);
+    *text = 0;
+    for (int i = 0; i < argc && len + 2 < ANNOTATION_LENGTH; ++i) {
+        if (i)
+            text[len++] = ' ';
+        atom_string(argv + i, text + len, ANNOTATION_LENGTH - len);
+        len += strlen(text + len);
+    }
+    now = lslpd_timebase_stamp(&x->timebase);
+    memcpy(frame, &now, sizeof(double));
+    lslpd_ring_commit(&x->annotations, 1);
+}
+
+void lslrecord_free(t_lslrecord *x){
+    if (x->worker_running) {
+        __atomic_store_n(&x->worker_quit, 1, __ATOMIC_RELEASE);
+        pthread_join(x->worker, NULL);
+        x->worker_running = 0;
+        lslrecord_release(x);
+    }
+    clock_free(x->clock);
+    if (x->resolver)
+        lsl_destroy_continuous_resolver(x->resolver);
+    if (x->info)
+        lsl_destroy_streaminfo(x->info);
+}
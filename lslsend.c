@@ -6,17 +6,19 @@
 
 #include "m_pd.h"      //pd header file
 #include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-#define MAX_EVENT_LENGTH 4096
 #define DEFAULT_STREAM_NAME "pd_send"
 #define DEFAULT_STREAM_TYPE "EEG"
 #define DEFAULT_DATA_TYPE "string"
 #define DEFAULT_NCHAN 1
 #define MAX_ARG_LENGTH 50
 #define MAX_DATA_TYPE_LENGTH 32
+#define DEFAULT_FLUSH_INTERVAL_MS 10    //batch mode: longest a sample waits before it is sent
+#define NUMBER_LENGTH 32        //string streams: room for a number sent as text
 
 
 //TODO: any need to expose the lsl timestamp of event?
@@ -25,17 +27,42 @@ static t_class *lslsend_class;
 typedef struct _lslsend{
 	t_object x_obj;
     
-    char eventcode[MAX_EVENT_LENGTH];            /* current event code */
 	lsl_streaminfo lsl_info;     //the streaminfo returned by the resolve call 
 	char  lsl_stream_name[MAX_ARG_LENGTH]; /* Stream Name */
 	char lsl_stream_type[MAX_ARG_LENGTH];
     int lsl_nchan;              /* number of channels in the stream (speacified when creating object) */
 	lsl_channel_format_t lsl_channel_format;
+    const t_lslpd_format *format;   /* conversion and push routines for the format */
+    void *sample;               /* one sample in the format's C type */
+    char *sample_text;          /* string streams: numbers printed as text */
+
+    /* batch mode: samples collect here with their logical-time stamps and go
+       out as one chunk when the buffer is full or the flush clock fires */
+    int batch_frames;           /* buffer size in samples, 0 = push every sample */
+    int batch_count;            /* samples waiting */
+    double flush_interval;      /* ms from the first waiting sample to the flush */
+    void *batch;                /* interleaved values in the format's C type */
+    double *batch_times;
+    char *batch_text;           /* string streams: numbers printed as text */
+    t_clock *flush_clock;
+    t_lslpd_timebase timebase;  /* maps logical time to the LSL clock */
+    int max_buffer;             /* liblsl buffer in seconds (hundreds of samples here) */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = per push */
     char data_type[MAX_ARG_LENGTH]; /* ui specified data type */
 
 	lsl_outlet lsl_outlet;		/* a stream outlet to push events to */
  	int lsl_errcode;			/* error code (lsl_lost_error or timeouts) */
-    double lsl_timestamp;		/* time stamp of the current sample (in sender time) */
+
+    /* statistics for the 'stats' method; with -stats they also go out of an
+       outlet periodically. Rates and timings cover the time since the
+       previous report. */
+    unsigned long pushed;       /* samples handed to liblsl */
+    unsigned long stats_pushed; /* 'pushed' at the previous report */
+    double stats_since;         /* logical time of the previous report */
+    t_lslpd_timing pushtime;    /* time spent in each push (or chunk push) */
+    t_outlet *out_stats;
+    t_clock *stats_clock;
+    double stats_interval;      /* ms between periodic reports, 0 = off */
 
 } t_lslsend;
 
@@ -45,12 +72,50 @@ void* lslsend_new(t_symbol* s, long argc, t_atom* argv);
 void  lslsend_free(t_lslsend* x);
 void  lslsend_assist(t_lslsend* x, void* b, long m, long a, char* s);
 void  lslsend_bang(t_lslsend *x);
-void  lslsend_push(t_lslsend *x, t_symbol *s, t_int argc, t_atom *argv);
+void  lslsend_push(t_lslsend *x, t_symbol *s, int argc, t_atom *argv);
+void  lslsend_flush(t_lslsend *x);
+void  lslsend_stats(t_lslsend *x, t_symbol *s, int argc, t_atom *argv);
+static void lslsend_stats_tick(t_lslsend *x);
 
 void* lslsend_new(t_symbol* s, long argc, t_atom* argv){
     
 	t_lslsend *x = (t_lslsend *)pd_new(lslsend_class);
 
+    x->flush_interval = DEFAULT_FLUSH_INTERVAL_MS;
+    x->max_buffer = LSLPD_MAX_BUFFER;
+
+    /* Flags (-batch <samples>, -flush <ms>, -stats <ms>, -maxbuffer <seconds>,
+       -chunk <samples>) may follow the stream arguments */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-batch") && i + 1 < argc) {
+            x->batch_frames = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-flush") && i + 1 < argc) {
+            x->flush_interval = atom_getfloat(&argv[++i]);
+        } else if (!strcmp(flag, "-stats") && i + 1 < argc) {
+            x->stats_interval = atom_getfloat(&argv[++i]);
+            x->stats_clock = clock_new(x, (t_method)lslsend_stats_tick);
+        } else if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    argc = npos;
+    if (x->batch_frames < 0)
+        x->batch_frames = 0;
+    if (x->flush_interval < 0)
+        x->flush_interval = 0;
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+    if (x->max_chunk < 0)
+        x->max_chunk = 0;
+
     // get event stream name if specified, else use default
     if (argc>=1 && argv[0].a_type==A_SYMBOL) {
         strncpy(x->lsl_stream_name, atom_getsymbol(&argv[0])->s_name, MAX_ARG_LENGTH);
@@ -68,7 +133,7 @@ void* lslsend_new(t_symbol* s, long argc, t_atom* argv){
 	/* Number of Channels */
 	if (argc>=3 && argv[2].a_type==A_FLOAT) {
 	    x->lsl_nchan = atom_getint(&argv[2]);
-	    if (x->lsl_nchan < 0) {
+	    if (x->lsl_nchan < 1) {
 	        x->lsl_nchan = 1;
 	        post("Warning: Must specify at least one channel. Defaulting to one channel.");
 	    }
@@ -85,21 +150,27 @@ void* lslsend_new(t_symbol* s, long argc, t_atom* argv){
 	}
 
 	// handle data-type specifics
-	if (!strcmp(x->data_type, "string") || !strcmp(x->data_type, "string32")) {
-	    x->lsl_channel_format = cft_string;
-	} else if (!strcmp(x->data_type, "float") || !strcmp(x->data_type, "float32")) {
-	    x->lsl_channel_format = cft_float32;
-	} else {
+	if (!(x->format = lslpd_format_byname(x->data_type))) {
 	    post("ERROR: Unsupported data type (%s)",x->data_type);
 	    return NULL;
 	}
+	x->lsl_channel_format = x->format->format;
+	x->sample = lslpd_getbytes(x->lsl_nchan * x->format->value_bytes);
+	if (x->lsl_channel_format == cft_string)
+	    x->sample_text = (char *)lslpd_getbytes(x->lsl_nchan * NUMBER_LENGTH);
+	if (x->batch_frames) {
+	    x->batch = lslpd_getbytes(x->batch_frames * x->lsl_nchan * x->format->value_bytes);
+	    x->batch_times = (double *)lslpd_getbytes(x->batch_frames * sizeof(double));
+	    if (x->lsl_channel_format == cft_string)
+	        x->batch_text = (char *)lslpd_getbytes(x->batch_frames * x->lsl_nchan * NUMBER_LENGTH);
+	    x->flush_clock = clock_new(x, (t_method)lslsend_flush);
+	}
 
     
-    x->eventcode[0]=0; //probably unnecessary--ensure event code is empty to start
 			
 	post("Creating a stream named '%s'.",x->lsl_stream_name);
 	x->lsl_info = lsl_create_streaminfo(x->lsl_stream_name,x->lsl_stream_type,x->lsl_nchan,0,x->lsl_channel_format,"uniqueid12345");
-    x->lsl_outlet = lsl_create_outlet(x->lsl_info, 0, 300);
+    x->lsl_outlet = lsl_create_outlet(x->lsl_info, x->max_chunk, x->max_buffer);
    
     if (x->lsl_outlet) {
         post("Stream created.\n");
@@ -107,7 +178,14 @@ void* lslsend_new(t_symbol* s, long argc, t_atom* argv){
         post("Problem creating stream. Events won't be sent.");
     }
 
+    lslpd_timebase_sync(&x->timebase);
     inlet_new(&x->x_obj,&x->x_obj.ob_pd,&s_symbol,gensym("push"));
+    if (x->stats_clock) {
+        x->out_stats = outlet_new(&x->x_obj, 0);
+        if (x->stats_interval > 0)
+            clock_delay(x->stats_clock, x->stats_interval);
+    }
+    x->stats_since = clock_getlogicaltime();
 	return x;
 }
 
@@ -119,8 +197,10 @@ void lslsend_setup(void) {
 							    CLASS_DEFAULT,
 							    A_GIMME,
 							   	0);   
-	class_addbang(lslsend_class, (t_method)lslsend_push);
+	class_addbang(lslsend_class, (t_method)lslsend_bang);
 	class_addlist(lslsend_class, (t_method)lslsend_push);
+	class_addmethod(lslsend_class, (t_method)lslsend_flush, gensym("flush"), 0);
+	class_addmethod(lslsend_class, (t_method)lslsend_stats, gensym("stats"), A_GIMME, 0);
 	// class_addmethod(lslsend_class, (t_method)lslsend_push, gensym("push"), A_GIMME, 0);
 }
 
@@ -128,35 +208,145 @@ void lslsend_setup(void) {
 
 void lslsend_free(t_lslsend* x){
 	/* Do any deallocation needed here. */
-    lsl_destroy_outlet(x->lsl_outlet);
+    if (x->flush_clock) {
+        lslsend_flush(x);
+        clock_free(x->flush_clock);
+    }
+    if (x->stats_clock)
+        clock_free(x->stats_clock);
+    if (x->batch) {
+        lslpd_freebytes(x->batch, x->batch_frames * x->lsl_nchan * x->format->value_bytes);
+        lslpd_freebytes(x->batch_times, x->batch_frames * sizeof(double));
+    }
+    if (x->batch_text)
+        lslpd_freebytes(x->batch_text, x->batch_frames * x->lsl_nchan * NUMBER_LENGTH);
+    if (x->lsl_outlet)
+        lsl_destroy_outlet(x->lsl_outlet);
+    if (x->lsl_info)
+        lsl_destroy_streaminfo(x->lsl_info);
+    if (x->sample)
+        lslpd_freebytes(x->sample, x->lsl_nchan * x->format->value_bytes);
+    if (x->sample_text)
+        lslpd_freebytes(x->sample_text, x->lsl_nchan * NUMBER_LENGTH);
 }
 
-// send the event code on a bang
+// a bang pushes an empty sample (all zeros for numeric streams)
 void  lslsend_bang(t_lslsend *x) {
-	post("niceeeee");
-    
-    // post("eventcode length= %d",strlen(x->eventcode));
-    
-
+	lslsend_push(x, &s_bang, 0, NULL);
 }
 
-// store then send first symbol in input out as event string
-void  lslsend_push(t_lslsend *x, t_symbol *s, t_int argc, t_atom *argv) {
-	int size = argc;
-	char *output[size];
-	unsigned int lengths[size];
-	for (int i=0;i<size;++i){
-		output[i] = atom_getsymbol(&argv[i])->s_name;
-		lengths[i] = strlen(output[i]);
+// write one sample (nchan values in the stream's format) to 'frame'; for string
+// streams symbols are referenced by name (Pd keeps those around) and numbers are
+// printed into 'text'. Missing channels are sent as 0 (or an empty string) and
+// extra values are ignored.
+static void lslsend_fill(t_lslsend *x, void *frame, char *text, int argc, t_atom *argv) {
+	int nchan = x->lsl_nchan;
+	int n = argc < nchan ? argc : nchan;
 
-		// post("%s",output[i]);
+	if (x->lsl_channel_format != cft_string) {
+	    x->format->from_atoms(frame, argv, n);
+	    if (n < nchan)
+	        memset((char *)frame + n * x->format->value_bytes, 0, (nchan - n) * x->format->value_bytes);
+	    return;
 	}
-	for (int i=0;i<size;++i){
-		post("%s", output[i]);
-		post("%d", lengths[i]);
+	const char **values = (const char **)frame;
+	for (int k = 0; k < nchan; ++k) {
+	    if (k >= n) {
+	        values[k] = "";
+	    } else if (argv[k].a_type == A_SYMBOL) {
+	        values[k] = argv[k].a_w.w_symbol->s_name;
+	    } else {
+	        atom_string(&argv[k], text + k * NUMBER_LENGTH, NUMBER_LENGTH);
+	        values[k] = text + k * NUMBER_LENGTH;
+	    }
 	}
+}
 
-	// test it out from here
-	lsl_push_sample_str(x->lsl_outlet,&output);
+// send everything collected so far as one chunk
+void  lslsend_flush(t_lslsend *x) {
+	if (!x->batch_count)
+	    return;
+	clock_unset(x->flush_clock);
+	if (x->lsl_outlet) {
+	    double start = lsl_local_clock();
+	    x->format->push_chunk_n(x->lsl_outlet, x->batch,
+	        (unsigned long)x->batch_count * x->lsl_nchan, x->batch_times);
+	    lslpd_timing_add(&x->pushtime, lsl_local_clock() - start);
+	    x->pushed += x->batch_count;
+	}
+	x->batch_count = 0;
 }
 
+// batch mode: queue the sample with its time stamp
+static void lslsend_push_batch(t_lslsend *x, int argc, t_atom *argv) {
+	size_t framebytes = x->lsl_nchan * x->format->value_bytes;
+	int i = x->batch_count;
+
+	if (!i)
+	    clock_delay(x->flush_clock, x->flush_interval);
+	lslsend_fill(x, (char *)x->batch + i * framebytes,
+	    x->batch_text ? x->batch_text + i * x->lsl_nchan * NUMBER_LENGTH : NULL, argc, argv);
+	x->batch_times[i] = lslpd_timebase_stamp(&x->timebase);
+	if (++x->batch_count == x->batch_frames)
+	    lslsend_flush(x);
+}
+
+// convert a list to one sample of the stream's format and push it (or queue it
+// in batch mode); this runs for every message, so it neither allocates nor posts
+void  lslsend_push(t_lslsend *x, t_symbol *s, int argc, t_atom *argv) {
+	if (!x->lsl_outlet)
+	    return;
+	if (x->batch_frames) {
+	    lslsend_push_batch(x, argc, argv);
+	    return;
+	}
+	double stamp, start;
+
+	lslsend_fill(x, x->sample, x->sample_text, argc, argv);
+	stamp = lslpd_timebase_stamp(&x->timebase);
+	start = lsl_local_clock();
+	x->format->push_sample(x->lsl_outlet, x->sample, stamp);
+	lslpd_timing_add(&x->pushtime, lsl_local_clock() - start);
+	x->pushed++;
+}
+
+// report the statistics on the stats outlet (or the console without one):
+// "rate", "pushed", "consumers" and the push timing as "pushtime <min> <mean>
+// <max>" in microseconds plus "pushhist"
+static void lslsend_stats_report(t_lslsend *x) {
+	double elapsed = clock_gettimesince(x->stats_since) * 0.001;
+	t_atom a;
+
+	SETFLOAT(&a, elapsed > 0 ? (x->pushed - x->stats_pushed) / elapsed : 0);
+	lslpd_stats_out(x->out_stats, "lslsend", "rate", 1, &a);
+	SETFLOAT(&a, x->pushed);
+	lslpd_stats_out(x->out_stats, "lslsend", "pushed", 1, &a);
+	SETFLOAT(&a, x->lsl_outlet ? lsl_have_consumers(x->lsl_outlet) : 0);
+	lslpd_stats_out(x->out_stats, "lslsend", "consumers", 1, &a);
+	lslpd_timing_out(&x->pushtime, x->out_stats, "lslsend", "pushtime", "pushhist");
+
+	x->stats_pushed = x->pushed;
+	x->stats_since = clock_getlogicaltime();
+	lslpd_timing_clear(&x->pushtime);
+}
+
+static void lslsend_stats_tick(t_lslsend *x) {
+	if (x->stats_interval > 0)
+	    clock_delay(x->stats_clock, x->stats_interval);
+	lslsend_stats_report(x);
+}
+
+// 'stats' reports now; 'stats <ms>' sets the interval of periodic reports (0 = off)
+void  lslsend_stats(t_lslsend *x, t_symbol *s, int argc, t_atom *argv) {
+	if (!argc) {
+	    lslsend_stats_report(x);
+	    return;
+	}
+	x->stats_interval = atom_getfloat(argv);
+	if (!x->stats_clock)
+	    x->stats_clock = clock_new(x, (t_method)lslsend_stats_tick);
+	if (x->stats_interval > 0)
+	    clock_delay(x->stats_clock, x->stats_interval);
+	else
+	    clock_unset(x->stats_clock);
+}
@@ -0,0 +1,182 @@
+/* lslsend~.c
+*
+* Publishes N audio signals as one LSL stream. Each DSP block is interleaved
+* and pushed with a single lsl_push_chunk_ft call, time stamped from Pd's
+* logical time. That follows the audio device's clock, so the mapping onto the
+* LSL clock is renewed as the blocks go out (see lslpd_timebase_stamp).
+*
+*/
+
+#include "m_pd.h"      //pd header file
+#include "lsl_c.h"     //LSL header file
+#include "lslpd.h"     //shared helpers
+#include <stdio.h>
+#include <string.h>
+
+#define DEFAULT_STREAM_NAME "pd_send"
+#define DEFAULT_STREAM_TYPE "Audio"
+#define DEFAULT_NCHAN 1
+#define MAX_ARG_LENGTH 50
+
+
+static t_class *lslsend_tilde_class;
+
+typedef struct _lslsend_tilde{
+	t_object x_obj;
+    t_float x_f;                /* dummy for the main signal inlet */
+
+	lsl_streaminfo lsl_info;
+	char lsl_stream_name[MAX_ARG_LENGTH]; /* Stream Name */
+	char lsl_stream_type[MAX_ARG_LENGTH];
+    int lsl_nchan;              /* number of channels = number of signal inlets */
+    double lsl_srate;           /* nominal rate the outlet was created with */
+    double block_srate;         /* Pd's sample rate, read in the dsp method */
+
+	lsl_outlet lsl_outlet;		/* a stream outlet to push blocks to */
+
+    t_sample **invec;           /* signal inlet vectors, set in the dsp method */
+    float *chunk;               /* one interleaved block */
+    int chunk_frames;           /* block size the chunk buffer was sized for */
+    t_lslpd_timebase timebase;  /* logical time -> LSL time */
+    int max_buffer;             /* liblsl buffer in seconds */
+    int max_chunk;              /* liblsl transmission chunk in samples, 0 = one block */
+
+} t_lslsend_tilde;
+
+
+
+void* lslsend_tilde_new(t_symbol* s, long argc, t_atom* argv);
+void  lslsend_tilde_free(t_lslsend_tilde* x);
+void  lslsend_tilde_dsp(t_lslsend_tilde *x, t_signal **sp);
+t_int *lslsend_tilde_perform(t_int *w);
+
+void* lslsend_tilde_new(t_symbol* s, long argc, t_atom* argv){
+
+	t_lslsend_tilde *x = (t_lslsend_tilde *)pd_new(lslsend_tilde_class);
+
+    x->max_buffer = LSLPD_MAX_BUFFER;
+
+    /* Flags (-maxbuffer <seconds>, -chunk <samples>) may follow the stream arguments */
+    int npos = 0;
+    while (npos < argc && !(argv[npos].a_type == A_SYMBOL && atom_getsymbol(&argv[npos])->s_name[0] == '-'))
+        npos++;
+    for (int i = npos; i < argc; ++i) {
+        const char *flag = atom_getsymbol(&argv[i])->s_name;
+        if (!strcmp(flag, "-maxbuffer") && i + 1 < argc) {
+            x->max_buffer = atom_getint(&argv[++i]);
+        } else if (!strcmp(flag, "-chunk") && i + 1 < argc) {
+            x->max_chunk = atom_getint(&argv[++i]);
+        } else {
+            post("Warning: ignoring unknown argument '%s'", flag);
+        }
+    }
+    argc = npos;
+    if (x->max_buffer < 1)
+        x->max_buffer = 1;
+    if (x->max_chunk < 0)
+        x->max_chunk = 0;
+
+    // get stream name if specified, else use default
+    if (argc>=1 && argv[0].a_type==A_SYMBOL) {
+        strncpy(x->lsl_stream_name, atom_getsymbol(&argv[0])->s_name, MAX_ARG_LENGTH);
+    } else {
+        strncpy(x->lsl_stream_name, DEFAULT_STREAM_NAME, MAX_ARG_LENGTH);
+        post(" Using default stream name '%s'",x->lsl_stream_name);
+    }
+    /* Stream type */
+	if (argc>=2 && argv[1].a_type==A_SYMBOL){
+	    strncpy(x->lsl_stream_type,atom_getsymbol(&argv[1])->s_name, MAX_ARG_LENGTH);
+	} else {
+	    strncpy(x->lsl_stream_type, DEFAULT_STREAM_TYPE, MAX_ARG_LENGTH);
+	    post(" Using default stream type (%s)",x->lsl_stream_type);
+	}
+	/* Number of Channels */
+	if (argc>=3 && argv[2].a_type==A_FLOAT) {
+	    x->lsl_nchan = atom_getint(&argv[2]);
+	    if (x->lsl_nchan < 1) {
+	        x->lsl_nchan = 1;
+	        post("Warning: Must specify at least one channel. Defaulting to one channel.");
+	    }
+	} else {
+	    post(" Using default number of channels (%d).",DEFAULT_NCHAN);
+	    x->lsl_nchan = DEFAULT_NCHAN;
+	}
+
+    x->invec = (t_sample **)getbytes(x->lsl_nchan * sizeof(t_sample *));
+    x->chunk = NULL;
+    x->chunk_frames = 0;
+    for (int k = 1; k < x->lsl_nchan; ++k)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+
+    // the stream advertises Pd's sample rate, so receivers can treat it as regular
+    x->lsl_srate = sys_getsr();
+	post("Creating a stream named '%s' (%d channels at %g Hz).",x->lsl_stream_name,x->lsl_nchan,x->lsl_srate);
+	x->lsl_info = lsl_create_streaminfo(x->lsl_stream_name,x->lsl_stream_type,x->lsl_nchan,x->lsl_srate,cft_float32,"");
+    x->lsl_outlet = lsl_create_outlet(x->lsl_info, x->max_chunk, x->max_buffer);
+
+    if (x->lsl_outlet) {
+        post("Stream created.\n");
+    } else {
+        post("Problem creating stream. Signals won't be sent.");
+    }
+	return x;
+}
+
+void lslsend_tilde_setup(void) {
+  lslsend_tilde_class = class_new(gensym("lslsend~"),
+							    (t_newmethod)lslsend_tilde_new,
+							    (t_method)lslsend_tilde_free,
+							    sizeof(t_lslsend_tilde),
+							    CLASS_DEFAULT,
+							    A_GIMME,
+							   	0);
+	CLASS_MAINSIGNALIN(lslsend_tilde_class, t_lslsend_tilde, x_f);
+	class_addmethod(lslsend_tilde_class, (t_method)lslsend_tilde_dsp, gensym("dsp"), A_CANT, 0);
+}
+
+
+
+void lslsend_tilde_free(t_lslsend_tilde* x){
+    if (x->lsl_outlet)
+        lsl_destroy_outlet(x->lsl_outlet);
+    if (x->lsl_info)
+        lsl_destroy_streaminfo(x->lsl_info);
+    if (x->chunk)
+        freebytes(x->chunk, x->chunk_frames * x->lsl_nchan * sizeof(float));
+    freebytes(x->invec, x->lsl_nchan * sizeof(t_sample *));
+}
+
+void lslsend_tilde_dsp(t_lslsend_tilde *x, t_signal **sp){
+    int n = sp[0]->s_n;
+
+    x->block_srate = sys_getsr();
+    if (x->block_srate != x->lsl_srate)
+        pd_error(x, "lslsend~: DSP runs at %g Hz but the stream was created at %g Hz",
+            x->block_srate, x->lsl_srate);
+    if (n != x->chunk_frames) {
+        size_t oldsize = x->chunk_frames * x->lsl_nchan * sizeof(float);
+        size_t newsize = n * x->lsl_nchan * sizeof(float);
+        x->chunk = (float *)(x->chunk ? resizebytes(x->chunk, oldsize, newsize) : getbytes(newsize));
+        x->chunk_frames = n;
+    }
+    for (int k = 0; k < x->lsl_nchan; ++k)
+        x->invec[k] = sp[k]->s_vec;
+    lslpd_timebase_sync(&x->timebase);
+    dsp_add(lslsend_tilde_perform, 2, x, (t_int)n);
+}
+
+t_int *lslsend_tilde_perform(t_int *w){
+    t_lslsend_tilde *x = (t_lslsend_tilde *)(w[1]);
+    int n = (int)(w[2]);
+    int nchan = x->lsl_nchan;
+
+    if (!x->lsl_outlet || !x->chunk)
+        return (w+3);
+
+    lslpd_interleave(x->chunk, x->invec, nchan, n);
+    // logical time is the start of the block; LSL wants the stamp of the last sample
+    lsl_push_chunk_ft(x->lsl_outlet, x->chunk, (unsigned long)n * nchan,
+        lslpd_timebase_stamp(&x->timebase) + (n - 1) / x->block_srate);
+
+    return (w+3);
+}